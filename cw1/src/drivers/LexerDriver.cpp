@@ -1,26 +1,99 @@
 #include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <unistd.h>
+
 #include "antlr4-runtime/antlr4-runtime.h"
 
 #include "CoolLexer.h"
+#include "util/MappedCharStream.h"
 
 using namespace std;
 using namespace antlr4;
 
-/// Преобразува жетон в текст, който очаква системата за проверка на курсовата работа (част 1).
-string cool_token_to_string(Token *token)
+/// Натрупва изхода и го записва на блокове от по FLUSH_SIZE байта, вместо
+/// да прави по едно малко писане за всеки жетон.
+class OutputBuffer
 {
-    auto token_type = token->getType();
+public:
+    static constexpr size_t FLUSH_SIZE = 64 * 1024;
 
-    switch (token_type)
+    explicit OutputBuffer(int fd) : fd_(fd)
     {
-    case static_cast<size_t>(-1):
-        return "EOF";
+        buffer_.reserve(2 * FLUSH_SIZE);
+    }
+
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void append(string_view text) { buffer_.append(text); }
+
+    void append(char c) { buffer_.push_back(c); }
+
+    void append_number(long long number)
+    {
+        char digits[24];
+        auto end = to_chars(digits, digits + sizeof(digits), number).ptr;
+        buffer_.append(digits, end);
+    }
+
+    /// Завършва реда и записва буфера, ако се е напълнил.
+    void end_line()
+    {
+        buffer_.push_back('\n');
+        if (buffer_.size() >= FLUSH_SIZE)
+        {
+            flush();
+        }
+    }
 
+    /// При грешка при писане съобщава за нея веднъж и спира да пише; след
+    /// това failed() връща true.
+    void flush()
+    {
+        size_t written = 0;
+        while (!failed_ && written < buffer_.size())
+        {
+            ssize_t count = write(fd_, buffer_.data() + written, buffer_.size() - written);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                cerr << "Cannot write output: " << strerror(errno) << endl;
+                failed_ = true;
+                break;
+            }
+            written += count;
+        }
+        buffer_.clear();
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    int fd_;
+    string buffer_;
+    bool failed_ = false;
+};
+
+/// Имената на жетоните с фиксиран текст. Празен низ за всички останали.
+string_view fixed_token_name(size_t token_type)
+{
+    switch (token_type)
+    {
     case CoolLexer::SEMI:
         return "';'";
     case CoolLexer::LBRACE:
@@ -107,6 +180,27 @@ string cool_token_to_string(Token *token)
     case CoolLexer::ERROR:
         return "ERROR:";
 
+    default:
+        return "";
+    }
+}
+
+/// Преобразува жетон в текст, който очаква системата за проверка на курсовата работа (част 1).
+string cool_token_to_string(Token *token)
+{
+    auto token_type = token->getType();
+
+    auto fixed_name = fixed_token_name(token_type);
+    if (!fixed_name.empty())
+    {
+        return string(fixed_name);
+    }
+
+    switch (token_type)
+    {
+    case static_cast<size_t>(-1):
+        return "EOF";
+
     default:
         return "<Invalid Token>: " + token->toString();
     }
@@ -121,7 +215,7 @@ int getLine(CoolLexer *lexer, Token *token)
     return token->getLine() + lines_in_token;
 }
 
-void dump_cool_token(CoolLexer *lexer, ostream &out, Token *token)
+void dump_cool_token(CoolLexer *lexer, OutputBuffer &out, Token *token)
 {
     if (token->getType() == static_cast<size_t>(-1))
     {
@@ -129,48 +223,118 @@ void dump_cool_token(CoolLexer *lexer, ostream &out, Token *token)
         return;
     }
 
-    out << "#" << getLine(lexer, token) << " " << cool_token_to_string(token);
+    out.append('#');
+    out.append_number(getLine(lexer, token));
+    out.append(' ');
 
     auto token_type = token->getType();
+    auto fixed_name = fixed_token_name(token_type);
+    if (!fixed_name.empty())
+    {
+        out.append(fixed_name);
+    }
+    else
+    {
+        out.append(cool_token_to_string(token));
+    }
+
     auto token_start_char_index = token->getStartIndex();
     switch (token_type) {
     case CoolLexer::BOOL_CONST: {
-        out << " "
-            << (lexer->get_bool_value(token_start_char_index) ? "true"
-                                                              : "false");
+        out.append(lexer->get_bool_value(token_start_char_index) ? " true" : " false");
         break;
     }
 
     case CoolLexer::STR_CONST: {
-        out << " " << '"' << lexer->get_string_value(token_start_char_index) << '"';
+        out.append(" \"");
+        out.append(lexer->get_string_value(token_start_char_index));
+        out.append('"');
         break;
     }
 
     case CoolLexer::INT_CONST:
     {
-        out << " " << lexer->get_string_value(token_start_char_index);
+        out.append(' ');
+        out.append(lexer->get_string_value(token_start_char_index));
         break;
     }
     
     case CoolLexer::TYPEID:
     case CoolLexer::OBJECTID:
     {
-        out << " " << lexer->get_id_value(token_start_char_index);
+        out.append(' ');
+        out.append(lexer->get_id_value(token_start_char_index));
         break;
     }
 
     case CoolLexer::ERROR: {
-        out << " " << lexer->get_error_message(token_start_char_index);
+        out.append(' ');
+        out.append(lexer->get_error_message(token_start_char_index));
         break;
     }
     }
 
-    out << endl;
+    out.end_line();
+}
+
+/// Лексира входа `iterations` пъти и отпечатва колко жетона и мегабайта
+/// в секунда са обработени.
+int run_bench(MappedCharStream &input, long iterations)
+{
+    size_t tokens_per_pass = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+    {
+        input.seek(0);
+        CoolLexer lexer(&input);
+        lexer.removeErrorListener(&ConsoleErrorListener::INSTANCE);
+
+        CommonTokenStream tokenStream(&lexer);
+        tokenStream.fill();
+
+        // Без EOF.
+        tokens_per_pass = tokenStream.size() - 1;
+    }
+    chrono::duration<double> wall = chrono::steady_clock::now() - start;
+
+    double seconds = wall.count();
+    double total_tokens = static_cast<double>(tokens_per_pass) * iterations;
+    double total_mb = static_cast<double>(input.get_bytes().size()) * iterations / (1024 * 1024);
+
+    cout << fixed << setprecision(3)
+         << "Lexed " << input.get_bytes().size() << " bytes (" << tokens_per_pass
+         << " tokens) " << iterations << " times in " << seconds * 1000 << " ms\n"
+         << setprecision(0) << total_tokens / seconds << " tokens/s, "
+         << setprecision(2) << total_mb / seconds << " MB/s" << endl;
+
+    return 0;
 }
 
 int main(int argc, const char *argv[])
 {
-    ANTLRInputStream input(cin);
+    long bench_iterations = 0;
+    if (argc == 3 && string_view(argv[1]) == "--bench")
+    {
+        char *end = nullptr;
+        bench_iterations = strtol(argv[2], &end, 10);
+        if (*end != '\0' || bench_iterations <= 0)
+        {
+            bench_iterations = -1;
+        }
+    }
+    if (argc != 1 && bench_iterations <= 0)
+    {
+        cerr << "Usage: " << argv[0] << " [--bench <iterations>] < input" << endl;
+        return 1;
+    }
+
+    MappedCharStream input(STDIN_FILENO, "");
+
+    if (bench_iterations > 0)
+    {
+        return run_bench(input, bench_iterations);
+    }
     CoolLexer lexer(&input);
 
     // За временно скриване на грешките:
@@ -180,11 +344,14 @@ int main(int argc, const char *argv[])
 
     tokenStream.fill(); // Изчитане на всички жетони.
 
+    OutputBuffer out(STDOUT_FILENO);
+
     vector<Token *> tokens = tokenStream.getTokens();
     for (Token *token : tokens)
     {
-        dump_cool_token(&lexer, cout, token);
+        dump_cool_token(&lexer, out, token);
     };
 
-    return 0;
+    out.flush();
+    return out.failed() ? 1 : 0;
 }
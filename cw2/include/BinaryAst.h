@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "FastCoolParser.h"
+
+/// A compact binary form of an ast::Program, meant to be mapped into memory
+/// and walked in place by tools that would otherwise parse the same program
+/// again. All integers are little-endian, and the file is laid out as
+///
+///     BinaryAstHeader
+///     uint32_t      string_offsets[string_count + 1]
+///     char          string_data[string_offsets[string_count]]
+///     padding to a multiple of 4 bytes
+///     BinaryAstNode nodes[node_count]
+///
+/// String `i` is string_data[string_offsets[i], string_offsets[i + 1]), and
+/// every distinct string is stored once. The nodes are in preorder starting
+/// with the Program, so the children of a node follow it one subtree after
+/// another; a subtree is skipped by skipping `subtree_size` nodes.
+///
+/// The strings and the children of a node depend on its kind:
+///
+///     Program                      -               classes
+///     Class                        name, parent    features
+///     Attr                         name, type      initializer or NoExpr
+///     Method                       name, type      formals, then the body
+///     Formal                       name, type      -
+///     Branch                       name, type      body
+///     Object, Int, String, New     text            -
+///     Bool, NoExpr                 -               -
+///     Assign                       name            value
+///     Dispatch                     method          object, then arguments
+///     StaticDispatch               type, method    object, then arguments
+///     Let                          name, type      initializer, body
+///     Typcase                      -               scrutinee, then branches
+///     all other kinds              -               operands in order
+///
+/// The `flags` of a Bool is its value.
+struct BinaryAstHeader
+{
+    static constexpr char MAGIC[8] = {'C', 'O', 'O', 'L', 'A', 'S', 'T', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    /// String index of the name of the source file.
+    uint32_t file_name;
+    uint32_t string_count;
+    uint32_t node_count;
+};
+
+struct BinaryAstNode
+{
+    static constexpr uint32_t NO_STRING = UINT32_MAX;
+
+    ast::Kind kind;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t line;
+    uint32_t child_count;
+    /// Number of nodes in the subtree of this node, itself included.
+    uint32_t subtree_size;
+    uint32_t strings[2];
+};
+
+static_assert(sizeof(BinaryAstHeader) == 24);
+static_assert(sizeof(BinaryAstNode) == 24);
+
+/// Serializes `program`, parsed from the file called `file_name`.
+std::string write_binary_ast(const ast::Program &program,
+                             std::string_view file_name);
+
+/// Read-only access to a binary AST in memory, such as a mapped file.
+class BinaryAstView
+{
+private:
+    const BinaryAstHeader *header_;
+    const uint32_t *string_offsets_;
+    const char *string_data_;
+    std::span<const BinaryAstNode> nodes_;
+
+    BinaryAstView() = default;
+
+public:
+    /// Checks that `bytes` hold a well-formed binary AST. `bytes` must be
+    /// aligned to 4 bytes, as mapped and heap memory is, and must outlive the
+    /// view.
+    static std::optional<BinaryAstView> open(std::string_view bytes);
+
+    std::span<const BinaryAstNode> get_nodes() const { return nodes_; }
+
+    /// The empty string for NO_STRING.
+    std::string_view get_string(uint32_t index) const;
+
+    std::string_view get_file_name() const
+    {
+        return get_string(header_->file_name);
+    }
+};
+
+/// Rebuilds the program stored in `view` in `arena`. Returns null if the
+/// nodes don't form a COOL program.
+const ast::Program *read_binary_ast(const BinaryAstView &view,
+                                    AstArena &arena);
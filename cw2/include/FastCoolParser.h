@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "antlr4-runtime.h"
+
+/// The abstract syntax tree of a COOL program, with one node kind per label
+/// the tree printer knows.
+///
+/// Every node records the line the printer shows above it, which is the line
+/// of the last token of the grammar rule the node was made for. The nodes
+/// live in an AstArena and are never destroyed one by one, so they only hold
+/// plain pointers, spans and string views into the arena.
+namespace ast
+{
+
+enum class Kind : uint8_t
+{
+    // Expressions.
+    Assign,
+    StaticDispatch,
+    Dispatch,
+    Cond,
+    Loop,
+    Typcase,
+    Block,
+    Let,
+    Plus,
+    Sub,
+    Mul,
+    Divide,
+    Neg,
+    Lt,
+    Eq,
+    Le,
+    Comp,
+    Int,
+    String,
+    Bool,
+    New,
+    Isvoid,
+    NoExpr,
+    Object,
+
+    // The rest of the tree.
+    Attr,
+    Method,
+    Formal,
+    Branch,
+    Class,
+    Program,
+};
+
+struct Expr
+{
+    Kind kind;
+    size_t line;
+};
+
+/// `_object`, `_int`, `_string`, `_new`, and `_no_expr`, whose text is empty.
+struct Leaf : Expr
+{
+    std::string_view text;
+};
+
+struct Bool : Expr
+{
+    bool value;
+};
+
+/// `_neg`, `_comp` and `_isvoid`.
+struct Unary : Expr
+{
+    Expr *operand;
+};
+
+/// The arithmetic operators and the comparisons.
+struct Binary : Expr
+{
+    Expr *left;
+    Expr *right;
+};
+
+struct Assign : Expr
+{
+    std::string_view name;
+    Expr *value;
+};
+
+/// `_dispatch` and `_static_dispatch`. A dispatch without an explicit object
+/// has an `_object` named `self` on the line of the dispatch.
+struct Dispatch : Expr
+{
+    Expr *object;
+    std::string_view static_type;
+    std::string_view method;
+    std::span<Expr *> arguments;
+};
+
+struct Cond : Expr
+{
+    Expr *predicate;
+    Expr *then_branch;
+    Expr *else_branch;
+};
+
+struct Loop : Expr
+{
+    Expr *predicate;
+    Expr *body;
+};
+
+struct Block : Expr
+{
+    std::span<Expr *> body;
+};
+
+/// One variable of a `let`; a `let` with several variables is a chain of
+/// these.
+struct Let : Expr
+{
+    std::string_view name;
+    std::string_view type;
+    Expr *init;
+    Expr *body;
+};
+
+struct Branch
+{
+    size_t line;
+    std::string_view name;
+    std::string_view type;
+    Expr *body;
+};
+
+struct Typcase : Expr
+{
+    Expr *scrutinee;
+    std::span<Branch *> branches;
+};
+
+struct Formal
+{
+    size_t line;
+    std::string_view name;
+    std::string_view type;
+};
+
+/// An attribute, whose `body` is its initializer, or a method.
+struct Feature
+{
+    Kind kind;
+    size_t line;
+    std::string_view name;
+    std::string_view type;
+    std::span<Formal *> formals;
+    Expr *body;
+};
+
+struct Class
+{
+    size_t line;
+    std::string_view name;
+    std::string_view parent;
+    std::span<Feature *> features;
+};
+
+struct Program
+{
+    size_t line;
+    std::span<Class *> classes;
+};
+
+} // namespace ast
+
+/// Bump allocator for the AST. Everything allocated from it is freed at once
+/// when the arena is destroyed, so only trivially destructible types go in.
+class AstArena
+{
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::byte *cursor_ = nullptr;
+    std::byte *limit_ = nullptr;
+
+    void *allocate(size_t size, size_t alignment);
+
+public:
+    AstArena() = default;
+
+    AstArena(const AstArena &) = delete;
+    AstArena &operator=(const AstArena &) = delete;
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return new (allocate(sizeof(T), alignof(T)))
+            T{std::forward<Args>(args)...};
+    }
+
+    template <typename T>
+    std::span<T> copy(const std::vector<T> &items)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (items.empty())
+        {
+            return {};
+        }
+        auto *data = static_cast<T *>(
+            allocate(items.size() * sizeof(T), alignof(T)));
+        std::uninitialized_copy(items.begin(), items.end(), data);
+        return {data, items.size()};
+    }
+
+    std::string_view copy(std::string_view text);
+};
+
+/// A hand-written recursive descent parser for src/CoolParser.g4, with one
+/// function per level of operator precedence, that builds an ast::Program
+/// directly from the tokens of CoolLexer. It never builds ANTLR parse trees
+/// and never runs adaptive prediction: every decision in this grammar is made
+/// by the next two tokens, and where the grammar is ambiguous the parser is
+/// greedy, which is what ANTLR resolves those ambiguities to.
+///
+/// It only handles correct programs. On the first token that doesn't fit it
+/// gives up, and the caller is expected to parse with CoolParser instead,
+/// which reports the errors.
+class FastCoolParser
+{
+private:
+    AstArena arena_;
+
+    std::vector<antlr4::Token *> tokens_;
+    size_t position_ = 0;
+    size_t last_line_ = 0;
+
+    size_t peek(size_t offset = 0) const;
+    antlr4::Token *consume();
+    antlr4::Token *expect(size_t type);
+    std::string_view expect_text(size_t type);
+
+    ast::Class *parse_class();
+    ast::Feature *parse_feature();
+    ast::Formal *parse_formal();
+    std::span<ast::Expr *> parse_arguments();
+
+    ast::Expr *parse_expression();
+    ast::Expr *parse_comparison(bool allow_equal);
+    ast::Expr *parse_addition();
+    ast::Expr *parse_multiplication();
+    ast::Expr *parse_unary();
+    ast::Expr *parse_atom();
+    ast::Expr *parse_primary();
+    ast::Expr *parse_let();
+    ast::Expr *parse_typcase();
+
+    ast::Expr *make_leaf(ast::Kind kind, std::string_view text, size_t line);
+
+public:
+    /// `tokens` are those of a CommonTokenStream after `fill`, ending with
+    /// EOF.
+    explicit FastCoolParser(const std::vector<antlr4::Token *> &tokens);
+
+    FastCoolParser(const FastCoolParser &) = delete;
+    FastCoolParser &operator=(const FastCoolParser &) = delete;
+
+    /// Returns the program, which lives as long as the parser, or null if
+    /// the tokens are not a correct program.
+    const ast::Program *parse();
+};
+
+/// Prints `program` in the same format as the TreePrinter of the parser
+/// driver.
+std::string format_ast(const ast::Program &program,
+                       std::string_view file_name);
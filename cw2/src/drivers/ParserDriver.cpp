@@ -1,15 +1,28 @@
 #include <cctype>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "antlr4-runtime/antlr4-runtime.h"
 
+#include "BinaryAst.h"
 #include "CoolLexer.h"
 #include "CoolParser.h"
 #include "CoolParserBaseVisitor.h"
+#include "FastCoolParser.h"
+#include "util/MappedCharStream.h"
+#include "util/TwoStageParse.h"
 
 using namespace std;
 using namespace antlr4;
@@ -82,36 +95,44 @@ private:
     CoolLexer *lexer_;
     CoolParser *parser_;
     string file_name_;
-    int indent = 0;
     bool debug = false;
 
+    /// The whole tree is built up here and written out with one call.
+    string out_;
+    /// The spaces every line currently starts with.
+    string indent_;
+
     void increaseIndent()
     {
-        this->indent += 2;
+        this->indent_.append(2, ' ');
     }
 
     void decreaseIndent()
     {
-        this->indent -= 2;
+        this->indent_.resize(this->indent_.size() - 2);
     }
 
-    void printLine(string str)
+    void printLine(string_view str)
     {
         if (debug)
         {
-            cout << ">";
+            out_ += '>';
         }
-        for (int i = 0; i < indent; i++)
-        {
-            cout << " ";
-        }
-
-        cout << str << endl;
+        out_ += indent_;
+        out_ += str;
+        out_ += '\n';
     }
 
     void printRow(size_t row)
     {
-        printLine("#" + std::to_string(row));
+        if (debug)
+        {
+            out_ += '>';
+        }
+        out_ += indent_;
+        out_ += '#';
+        out_ += std::to_string(row);
+        out_ += '\n';
     }
 
 public:
@@ -655,6 +676,8 @@ public:
     print()
     {
         visitProgram(parser_->program());
+        cout.write(out_.data(), out_.size());
+        cout.flush();
     }
 };
 
@@ -683,24 +706,159 @@ public:
     bool has_error() const { return has_error_; }
 };
 
+/// Prints the tree stored in a file written with --emit-binary-ast. The file
+/// is mapped into memory and decoded straight from the mapping; nothing is
+/// lexed or parsed.
+int print_binary_ast(const char *file_path)
+{
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    struct stat info {};
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        cerr << "Cannot read input file " << file_path << endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = size > 0
+                        ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                        : MAP_FAILED;
+    close(fd);
+
+    optional<BinaryAstView> view;
+    if (mapping != MAP_FAILED)
+    {
+        view = BinaryAstView::open({static_cast<const char *>(mapping), size});
+    }
+
+    AstArena arena;
+    const ast::Program *program = nullptr;
+    if (view)
+    {
+        program = read_binary_ast(*view, arena);
+    }
+
+    int status = 0;
+    if (program != nullptr)
+    {
+        auto text = format_ast(*program, view->get_file_name());
+        cout.write(text.data(), text.size());
+        cout.flush();
+    }
+    else
+    {
+        cerr << file_path << ": not a binary AST" << endl;
+        status = 1;
+    }
+
+    if (mapping != MAP_FAILED)
+    {
+        munmap(mapping, size);
+    }
+    return status;
+}
+
 int main(int argc, const char *argv[])
 {
-    if (argc != 2)
+    // With --fast-parser, correct programs are parsed by FastCoolParser; with
+    // --parse-stats, which parser produced the tree is printed to stderr.
+    // --emit-binary-ast <path> writes the tree to <path> instead of printing
+    // it, and --read-binary-ast prints the tree stored in the input file.
+    bool fast_parser = false;
+    bool parse_stats = false;
+    const char *binary_ast_path = nullptr;
+    bool read_binary = false;
+    const char *file_path = nullptr;
+    bool bad_arguments = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if (arg == "--fast-parser")
+        {
+            fast_parser = true;
+        }
+        else if (arg == "--parse-stats")
+        {
+            parse_stats = true;
+        }
+        else if (arg == "--emit-binary-ast" && i + 1 < argc)
+        {
+            binary_ast_path = argv[++i];
+        }
+        else if (arg == "--read-binary-ast")
+        {
+            read_binary = true;
+        }
+        else if (file_path == nullptr && !arg.starts_with("--"))
+        {
+            file_path = argv[i];
+        }
+        else
+        {
+            bad_arguments = true;
+        }
+    }
+
+    if (bad_arguments || file_path == nullptr)
     {
         cerr << "Expecting exactly one argument: name of input file" << endl;
         return 1;
     }
 
-    auto file_path = argv[1];
-    ifstream fin(file_path);
+    if (!fs::is_regular_file(file_path))
+    {
+        cerr << "Cannot read input file " << file_path << endl;
+        return 1;
+    }
+
+    if (read_binary)
+    {
+        return print_binary_ast(file_path);
+    }
 
     auto file_name = fs::path(file_path).filename().string();
 
-    ANTLRInputStream input(fin);
+    MappedCharStream input(file_path);
     CoolLexer lexer(&input);
 
     CommonTokenStream tokenStream(&lexer);
 
+    if (fast_parser || binary_ast_path != nullptr)
+    {
+        tokenStream.fill();
+        FastCoolParser fast_cool_parser(tokenStream.getTokens());
+        if (auto *program = fast_cool_parser.parse())
+        {
+            if (parse_stats)
+            {
+                cerr << file_name << ": fast parser" << endl;
+            }
+
+            if (binary_ast_path == nullptr)
+            {
+                cout << format_ast(*program, file_name);
+                return 0;
+            }
+
+            auto bytes = write_binary_ast(*program, file_name);
+            ofstream out(binary_ast_path, ios::binary);
+            out.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+            if (!out.flush())
+            {
+                cerr << "Cannot write " << binary_ast_path << endl;
+                return 1;
+            }
+            return 0;
+        }
+        // Not a correct program; CoolParser reports what is wrong with it.
+    }
+
+    // Only built when it is needed, since building a CoolParser deserializes
+    // its ATN.
     CoolParser parser(&tokenStream);
 
     ErrorPrinter error_printer(file_name, &lexer);
@@ -709,10 +867,32 @@ int main(int argc, const char *argv[])
     parser.addErrorListener(&error_printer);
 
     // This will trigger the error_printer, in case there are errors.
-    parser.program();
+    bool fell_back;
+    parse_sll_then_ll(parser, fell_back, [&] { return parser.program(); });
     parser.reset();
 
-    if (!error_printer.has_error())
+    if (!fell_back)
+    {
+        // The input is known to parse in SLL mode, so TreePrinter parses it
+        // again in that mode.
+        parser.getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(
+            atn::PredictionMode::SLL);
+    }
+
+    if (parse_stats)
+    {
+        cerr << file_name << ": " << (fell_back ? "LL fallback" : "SLL")
+             << endl;
+    }
+
+    if (!error_printer.has_error() && binary_ast_path != nullptr)
+    {
+        // Only ASTs built by FastCoolParser can be written out.
+        cerr << file_name << ": cannot write a binary AST for this program"
+             << endl;
+        return 1;
+    }
+    else if (!error_printer.has_error())
     {
         TreePrinter(&lexer, &parser, file_name).print();
     }
@@ -0,0 +1,645 @@
+#include "BinaryAst.h"
+
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+using ast::Kind;
+
+static_assert(endian::native == endian::little,
+              "the binary AST is written in the byte order of the host");
+
+namespace
+{
+
+class BinaryAstWriter
+{
+private:
+    vector<BinaryAstNode> nodes_;
+    vector<uint32_t> string_offsets_{0};
+    string string_data_;
+    /// The keys point into the AST, which outlives the writer.
+    unordered_map<string_view, uint32_t> string_indices_;
+
+    uint32_t intern(string_view text)
+    {
+        auto [it, inserted] = string_indices_.try_emplace(
+            text, static_cast<uint32_t>(string_offsets_.size() - 1));
+        if (inserted)
+        {
+            string_data_.append(text);
+            string_offsets_.push_back(static_cast<uint32_t>(string_data_.size()));
+        }
+        return it->second;
+    }
+
+    /// Appends a node whose children are added next, and returns its index
+    /// for `finish`.
+    size_t add(Kind kind, size_t line, size_t child_count,
+               initializer_list<string_view> strings = {}, uint8_t flags = 0)
+    {
+        BinaryAstNode node{};
+        node.kind = kind;
+        node.flags = flags;
+        node.line = static_cast<uint32_t>(line);
+        node.child_count = static_cast<uint32_t>(child_count);
+        node.strings[0] = node.strings[1] = BinaryAstNode::NO_STRING;
+
+        size_t slot = 0;
+        for (auto text : strings)
+        {
+            node.strings[slot++] = intern(text);
+        }
+
+        nodes_.push_back(node);
+        return nodes_.size() - 1;
+    }
+
+    /// Called once all the children of the node at `index` are added.
+    void finish(size_t index)
+    {
+        nodes_[index].subtree_size =
+            static_cast<uint32_t>(nodes_.size() - index);
+    }
+
+    void write_expr(const ast::Expr *expr)
+    {
+        size_t index;
+        switch (expr->kind)
+        {
+        case Kind::Int:
+        case Kind::String:
+        case Kind::New:
+        case Kind::Object:
+            index = add(expr->kind, expr->line, 0,
+                        {static_cast<const ast::Leaf *>(expr)->text});
+            break;
+        case Kind::NoExpr:
+            index = add(expr->kind, expr->line, 0);
+            break;
+        case Kind::Bool:
+            index = add(expr->kind, expr->line, 0, {},
+                        static_cast<const ast::Bool *>(expr)->value);
+            break;
+        case Kind::Neg:
+        case Kind::Comp:
+        case Kind::Isvoid:
+            index = add(expr->kind, expr->line, 1);
+            write_expr(static_cast<const ast::Unary *>(expr)->operand);
+            break;
+        case Kind::Plus:
+        case Kind::Sub:
+        case Kind::Mul:
+        case Kind::Divide:
+        case Kind::Lt:
+        case Kind::Le:
+        case Kind::Eq:
+        {
+            auto *binary = static_cast<const ast::Binary *>(expr);
+            index = add(expr->kind, expr->line, 2);
+            write_expr(binary->left);
+            write_expr(binary->right);
+            break;
+        }
+        case Kind::Assign:
+        {
+            auto *assign = static_cast<const ast::Assign *>(expr);
+            index = add(expr->kind, expr->line, 1, {assign->name});
+            write_expr(assign->value);
+            break;
+        }
+        case Kind::StaticDispatch:
+        case Kind::Dispatch:
+        {
+            auto *dispatch = static_cast<const ast::Dispatch *>(expr);
+            size_t child_count = 1 + dispatch->arguments.size();
+            index = expr->kind == Kind::StaticDispatch
+                        ? add(expr->kind, expr->line, child_count,
+                              {dispatch->static_type, dispatch->method})
+                        : add(expr->kind, expr->line, child_count,
+                              {dispatch->method});
+            write_expr(dispatch->object);
+            for (auto *argument : dispatch->arguments)
+            {
+                write_expr(argument);
+            }
+            break;
+        }
+        case Kind::Cond:
+        {
+            auto *cond = static_cast<const ast::Cond *>(expr);
+            index = add(expr->kind, expr->line, 3);
+            write_expr(cond->predicate);
+            write_expr(cond->then_branch);
+            write_expr(cond->else_branch);
+            break;
+        }
+        case Kind::Loop:
+        {
+            auto *loop = static_cast<const ast::Loop *>(expr);
+            index = add(expr->kind, expr->line, 2);
+            write_expr(loop->predicate);
+            write_expr(loop->body);
+            break;
+        }
+        case Kind::Block:
+        {
+            auto body = static_cast<const ast::Block *>(expr)->body;
+            index = add(expr->kind, expr->line, body.size());
+            for (auto *item : body)
+            {
+                write_expr(item);
+            }
+            break;
+        }
+        case Kind::Let:
+        {
+            auto *let = static_cast<const ast::Let *>(expr);
+            index = add(expr->kind, expr->line, 2, {let->name, let->type});
+            write_expr(let->init);
+            write_expr(let->body);
+            break;
+        }
+        case Kind::Typcase:
+        {
+            auto *typcase = static_cast<const ast::Typcase *>(expr);
+            index = add(expr->kind, expr->line,
+                        1 + typcase->branches.size());
+            write_expr(typcase->scrutinee);
+            for (auto *branch : typcase->branches)
+            {
+                size_t branch_index = add(Kind::Branch, branch->line, 1,
+                                          {branch->name, branch->type});
+                write_expr(branch->body);
+                finish(branch_index);
+            }
+            break;
+        }
+        default:
+            return;
+        }
+        finish(index);
+    }
+
+    void write_feature(const ast::Feature *feature)
+    {
+        size_t index = add(feature->kind, feature->line,
+                           feature->formals.size() + 1,
+                           {feature->name, feature->type});
+        for (auto *formal : feature->formals)
+        {
+            finish(add(Kind::Formal, formal->line, 0,
+                       {formal->name, formal->type}));
+        }
+        write_expr(feature->body);
+        finish(index);
+    }
+
+public:
+    string write(const ast::Program &program, string_view file_name)
+    {
+        size_t program_index =
+            add(Kind::Program, program.line, program.classes.size());
+        for (auto *cls : program.classes)
+        {
+            size_t class_index = add(Kind::Class, cls->line,
+                                     cls->features.size(),
+                                     {cls->name, cls->parent});
+            for (auto *feature : cls->features)
+            {
+                write_feature(feature);
+            }
+            finish(class_index);
+        }
+        finish(program_index);
+
+        BinaryAstHeader header{};
+        memcpy(header.magic, BinaryAstHeader::MAGIC, sizeof(header.magic));
+        header.version = BinaryAstHeader::VERSION;
+        header.file_name = intern(file_name);
+        header.string_count =
+            static_cast<uint32_t>(string_offsets_.size() - 1);
+        header.node_count = static_cast<uint32_t>(nodes_.size());
+
+        string bytes;
+        bytes.reserve(sizeof(header) +
+                      string_offsets_.size() * sizeof(uint32_t) +
+                      string_data_.size() + 3 +
+                      nodes_.size() * sizeof(BinaryAstNode));
+        bytes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        bytes.append(reinterpret_cast<const char *>(string_offsets_.data()),
+                     string_offsets_.size() * sizeof(uint32_t));
+        bytes.append(string_data_);
+        bytes.resize((bytes.size() + 3) & ~size_t{3}, '\0');
+        bytes.append(reinterpret_cast<const char *>(nodes_.data()),
+                     nodes_.size() * sizeof(BinaryAstNode));
+        return bytes;
+    }
+};
+
+/// Rebuilds the AST from the nodes of a view, which `open` has checked to be
+/// well-formed trees, but not trees of the right kinds.
+class BinaryAstReader
+{
+private:
+    const BinaryAstView &view_;
+    AstArena &arena_;
+    span<const BinaryAstNode> nodes_;
+    size_t position_ = 0;
+
+    /// Thrown when a node is not what its parent expects, and caught in
+    /// `read`.
+    struct Malformed
+    {
+    };
+
+    const BinaryAstNode &next(size_t child_count)
+    {
+        auto &node = nodes_[position_++];
+        if (node.child_count != child_count)
+        {
+            throw Malformed{};
+        }
+        return node;
+    }
+
+    const BinaryAstNode &next_of(Kind kind)
+    {
+        if (position_ >= nodes_.size() || nodes_[position_].kind != kind)
+        {
+            throw Malformed{};
+        }
+        return nodes_[position_];
+    }
+
+    string_view string_at(const BinaryAstNode &node, size_t slot)
+    {
+        return arena_.copy(view_.get_string(node.strings[slot]));
+    }
+
+    template <typename Node, typename... Args>
+    ast::Expr *make(const BinaryAstNode &node, Args &&...args)
+    {
+        return arena_.make<Node>(ast::Expr{node.kind, node.line},
+                                 std::forward<Args>(args)...);
+    }
+
+    ast::Expr *read_expr()
+    {
+        if (position_ >= nodes_.size())
+        {
+            throw Malformed{};
+        }
+
+        auto &node = nodes_[position_];
+        switch (node.kind)
+        {
+        case Kind::Int:
+        case Kind::String:
+        case Kind::New:
+        case Kind::Object:
+            next(0);
+            return make<ast::Leaf>(node, string_at(node, 0));
+        case Kind::NoExpr:
+            next(0);
+            return make<ast::Leaf>(node, string_view{});
+        case Kind::Bool:
+            next(0);
+            return make<ast::Bool>(node, node.flags != 0);
+        case Kind::Neg:
+        case Kind::Comp:
+        case Kind::Isvoid:
+        {
+            next(1);
+            auto *operand = read_expr();
+            return make<ast::Unary>(node, operand);
+        }
+        case Kind::Plus:
+        case Kind::Sub:
+        case Kind::Mul:
+        case Kind::Divide:
+        case Kind::Lt:
+        case Kind::Le:
+        case Kind::Eq:
+        {
+            next(2);
+            auto *left = read_expr();
+            auto *right = read_expr();
+            return make<ast::Binary>(node, left, right);
+        }
+        case Kind::Assign:
+        {
+            next(1);
+            auto name = string_at(node, 0);
+            auto *value = read_expr();
+            return make<ast::Assign>(node, name, value);
+        }
+        case Kind::StaticDispatch:
+        case Kind::Dispatch:
+        {
+            if (node.child_count == 0)
+            {
+                throw Malformed{};
+            }
+            next(node.child_count);
+
+            bool is_static = node.kind == Kind::StaticDispatch;
+            string_view static_type = is_static ? string_at(node, 0) : "";
+            auto method = string_at(node, is_static ? 1 : 0);
+            auto *object = read_expr();
+
+            vector<ast::Expr *> arguments;
+            for (size_t i = 1; i < node.child_count; ++i)
+            {
+                arguments.push_back(read_expr());
+            }
+            return make<ast::Dispatch>(node, object, static_type, method,
+                                       arena_.copy(arguments));
+        }
+        case Kind::Cond:
+        {
+            next(3);
+            auto *predicate = read_expr();
+            auto *then_branch = read_expr();
+            auto *else_branch = read_expr();
+            return make<ast::Cond>(node, predicate, then_branch, else_branch);
+        }
+        case Kind::Loop:
+        {
+            next(2);
+            auto *predicate = read_expr();
+            auto *body = read_expr();
+            return make<ast::Loop>(node, predicate, body);
+        }
+        case Kind::Block:
+        {
+            if (node.child_count == 0)
+            {
+                throw Malformed{};
+            }
+            next(node.child_count);
+
+            vector<ast::Expr *> body;
+            for (size_t i = 0; i < node.child_count; ++i)
+            {
+                body.push_back(read_expr());
+            }
+            return make<ast::Block>(node, arena_.copy(body));
+        }
+        case Kind::Let:
+        {
+            next(2);
+            auto name = string_at(node, 0);
+            auto type = string_at(node, 1);
+            auto *init = read_expr();
+            auto *body = read_expr();
+            return make<ast::Let>(node, name, type, init, body);
+        }
+        case Kind::Typcase:
+        {
+            if (node.child_count < 2)
+            {
+                throw Malformed{};
+            }
+            next(node.child_count);
+            auto *scrutinee = read_expr();
+
+            vector<ast::Branch *> branches;
+            for (size_t i = 1; i < node.child_count; ++i)
+            {
+                auto &branch = next_of(Kind::Branch);
+                next(1);
+                auto name = string_at(branch, 0);
+                auto type = string_at(branch, 1);
+                auto *body = read_expr();
+                branches.push_back(
+                    arena_.make<ast::Branch>(branch.line, name, type, body));
+            }
+            return make<ast::Typcase>(node, scrutinee, arena_.copy(branches));
+        }
+        default:
+            throw Malformed{};
+        }
+    }
+
+    ast::Feature *read_feature()
+    {
+        if (position_ >= nodes_.size())
+        {
+            throw Malformed{};
+        }
+
+        auto &node = nodes_[position_];
+        vector<ast::Formal *> formals;
+        if (node.kind == Kind::Attr)
+        {
+            next(1);
+        }
+        else if (node.kind == Kind::Method && node.child_count > 0)
+        {
+            next(node.child_count);
+            for (size_t i = 1; i < node.child_count; ++i)
+            {
+                auto &formal = next_of(Kind::Formal);
+                next(0);
+                formals.push_back(arena_.make<ast::Formal>(
+                    formal.line, string_at(formal, 0), string_at(formal, 1)));
+            }
+        }
+        else
+        {
+            throw Malformed{};
+        }
+
+        auto name = string_at(node, 0);
+        auto type = string_at(node, 1);
+        auto *body = read_expr();
+        return arena_.make<ast::Feature>(node.kind, node.line, name, type,
+                                         arena_.copy(formals), body);
+    }
+
+    ast::Class *read_class()
+    {
+        auto &node = next_of(Kind::Class);
+        next(node.child_count);
+
+        auto name = string_at(node, 0);
+        auto parent = string_at(node, 1);
+        vector<ast::Feature *> features;
+        for (size_t i = 0; i < node.child_count; ++i)
+        {
+            features.push_back(read_feature());
+        }
+        return arena_.make<ast::Class>(node.line, name, parent,
+                                       arena_.copy(features));
+    }
+
+public:
+    BinaryAstReader(const BinaryAstView &view, AstArena &arena)
+        : view_(view), arena_(arena), nodes_(view.get_nodes())
+    {
+    }
+
+    const ast::Program *read()
+    {
+        try
+        {
+            auto &node = next_of(Kind::Program);
+            if (node.child_count == 0)
+            {
+                return nullptr;
+            }
+            next(node.child_count);
+
+            vector<ast::Class *> classes;
+            for (size_t i = 0; i < node.child_count; ++i)
+            {
+                classes.push_back(read_class());
+            }
+            return arena_.make<ast::Program>(node.line, arena_.copy(classes));
+        }
+        catch (const Malformed &)
+        {
+            return nullptr;
+        }
+    }
+};
+
+} // namespace
+
+string write_binary_ast(const ast::Program &program, string_view file_name)
+{
+    return BinaryAstWriter().write(program, file_name);
+}
+
+optional<BinaryAstView> BinaryAstView::open(string_view bytes)
+{
+    if (bytes.size() < sizeof(BinaryAstHeader) ||
+        reinterpret_cast<uintptr_t>(bytes.data()) % alignof(uint32_t) != 0)
+    {
+        return nullopt;
+    }
+
+    BinaryAstView view;
+    view.header_ = reinterpret_cast<const BinaryAstHeader *>(bytes.data());
+    auto &header = *view.header_;
+    if (memcmp(header.magic, BinaryAstHeader::MAGIC, sizeof(header.magic)) !=
+            0 ||
+        header.version != BinaryAstHeader::VERSION ||
+        header.file_name >= header.string_count)
+    {
+        return nullopt;
+    }
+
+    // Sizes are checked in 64 bits, so that no count in the header can make
+    // them wrap around.
+    uint64_t offsets_end = sizeof(BinaryAstHeader) +
+                           (uint64_t{header.string_count} + 1) * sizeof(uint32_t);
+    if (offsets_end > bytes.size())
+    {
+        return nullopt;
+    }
+    view.string_offsets_ =
+        reinterpret_cast<const uint32_t *>(bytes.data() + sizeof(header));
+    for (uint32_t i = 0; i < header.string_count; ++i)
+    {
+        if (view.string_offsets_[i] > view.string_offsets_[i + 1])
+        {
+            return nullopt;
+        }
+    }
+    if (view.string_offsets_[0] != 0)
+    {
+        return nullopt;
+    }
+
+    uint64_t data_end =
+        offsets_end + view.string_offsets_[header.string_count];
+    uint64_t nodes_begin = (data_end + 3) & ~uint64_t{3};
+    if (nodes_begin + uint64_t{header.node_count} * sizeof(BinaryAstNode) !=
+        bytes.size())
+    {
+        return nullopt;
+    }
+    view.string_data_ = bytes.data() + offsets_end;
+    view.nodes_ = {
+        reinterpret_cast<const BinaryAstNode *>(bytes.data() + nodes_begin),
+        header.node_count};
+
+    // Every subtree must end inside its parent, and its children must fill
+    // it exactly, so that skipping `subtree_size` nodes is always safe.
+    vector<uint32_t> remaining_children;
+    vector<size_t> subtree_ends;
+    for (size_t i = 0; i < view.nodes_.size(); ++i)
+    {
+        auto &node = view.nodes_[i];
+        if (node.kind > Kind::Program || node.subtree_size == 0 ||
+            node.subtree_size > view.nodes_.size() - i)
+        {
+            return nullopt;
+        }
+        for (auto string : node.strings)
+        {
+            if (string != BinaryAstNode::NO_STRING &&
+                string >= header.string_count)
+            {
+                return nullopt;
+            }
+        }
+
+        if (i == 0)
+        {
+            if (node.subtree_size != view.nodes_.size())
+            {
+                return nullopt;
+            }
+        }
+        else
+        {
+            if (remaining_children.empty() || remaining_children.back() == 0 ||
+                i + node.subtree_size > subtree_ends.back())
+            {
+                return nullopt;
+            }
+            --remaining_children.back();
+        }
+
+        remaining_children.push_back(node.child_count);
+        subtree_ends.push_back(i + node.subtree_size);
+        while (!subtree_ends.empty() && subtree_ends.back() == i + 1)
+        {
+            if (remaining_children.back() != 0)
+            {
+                return nullopt;
+            }
+            remaining_children.pop_back();
+            subtree_ends.pop_back();
+        }
+    }
+    if (!subtree_ends.empty())
+    {
+        return nullopt;
+    }
+
+    return view;
+}
+
+string_view BinaryAstView::get_string(uint32_t index) const
+{
+    if (index == BinaryAstNode::NO_STRING)
+    {
+        return {};
+    }
+    return {string_data_ + string_offsets_[index],
+            string_offsets_[index + 1] - string_offsets_[index]};
+}
+
+const ast::Program *read_binary_ast(const BinaryAstView &view,
+                                    AstArena &arena)
+{
+    return BinaryAstReader(view, arena).read();
+}
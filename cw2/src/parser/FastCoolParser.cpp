@@ -0,0 +1,815 @@
+#include "FastCoolParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "CoolLexer.h"
+
+using namespace std;
+using namespace antlr4;
+
+using ast::Kind;
+
+namespace
+{
+
+/// Thrown on the first token that doesn't fit, and caught in `parse`.
+struct Bail
+{
+};
+
+/// Gives the first `count` nodes of a left-leaning chain such as `a + b - c`
+/// or `a.f().g()` the same line. The tree printer shows every operator of a
+/// chain on the line of the end of the whole chain.
+template <typename Node>
+void set_chain_line(ast::Expr *node, size_t count, size_t line,
+                    ast::Expr *Node::*next)
+{
+    for (; count > 0; --count)
+    {
+        node->line = line;
+        node = static_cast<Node *>(node)->*next;
+    }
+}
+
+} // namespace
+
+void *AstArena::allocate(size_t size, size_t alignment)
+{
+    void *pointer = cursor_;
+    size_t space = static_cast<size_t>(limit_ - cursor_);
+    if (cursor_ == nullptr || align(alignment, size, pointer, space) == nullptr)
+    {
+        size_t block_size = max(BLOCK_SIZE, size + alignment);
+        blocks_.emplace_back(new byte[block_size]);
+        cursor_ = blocks_.back().get();
+        limit_ = cursor_ + block_size;
+
+        pointer = cursor_;
+        space = block_size;
+        align(alignment, size, pointer, space);
+    }
+
+    cursor_ = static_cast<byte *>(pointer) + size;
+    return pointer;
+}
+
+string_view AstArena::copy(string_view text)
+{
+    if (text.empty())
+    {
+        return {};
+    }
+    auto *data = static_cast<char *>(allocate(text.size(), 1));
+    memcpy(data, text.data(), text.size());
+    return {data, text.size()};
+}
+
+FastCoolParser::FastCoolParser(const vector<Token *> &tokens)
+{
+    tokens_.reserve(tokens.size());
+    for (auto *token : tokens)
+    {
+        if (token->getChannel() == Token::DEFAULT_CHANNEL)
+        {
+            tokens_.push_back(token);
+        }
+    }
+}
+
+size_t FastCoolParser::peek(size_t offset) const
+{
+    size_t index = position_ + offset;
+    return index < tokens_.size() ? tokens_[index]->getType() : Token::EOF;
+}
+
+Token *FastCoolParser::consume()
+{
+    if (position_ >= tokens_.size())
+    {
+        throw Bail{};
+    }
+    auto *token = tokens_[position_++];
+    last_line_ = token->getLine();
+    return token;
+}
+
+Token *FastCoolParser::expect(size_t type)
+{
+    if (peek() != type)
+    {
+        throw Bail{};
+    }
+    return consume();
+}
+
+string_view FastCoolParser::expect_text(size_t type)
+{
+    return arena_.copy(expect(type)->getText());
+}
+
+ast::Expr *FastCoolParser::make_leaf(Kind kind, string_view text, size_t line)
+{
+    return arena_.make<ast::Leaf>(ast::Expr{kind, line}, text);
+}
+
+const ast::Program *FastCoolParser::parse()
+{
+    try
+    {
+        vector<ast::Class *> classes;
+        do
+        {
+            classes.push_back(parse_class());
+            expect(CoolLexer::SEMI);
+        } while (peek() == CoolLexer::CLASS);
+
+        // CoolParser stops after the last class without looking at what
+        // follows; leave that case to it.
+        if (peek() != Token::EOF)
+        {
+            return nullptr;
+        }
+
+        return arena_.make<ast::Program>(last_line_, arena_.copy(classes));
+    }
+    catch (const Bail &)
+    {
+        return nullptr;
+    }
+}
+
+ast::Class *FastCoolParser::parse_class()
+{
+    expect(CoolLexer::CLASS);
+    auto name = expect_text(CoolLexer::TYPEID);
+
+    string_view parent = "Object";
+    if (peek() == CoolLexer::INHERITS)
+    {
+        consume();
+        parent = expect_text(CoolLexer::TYPEID);
+    }
+
+    expect(CoolLexer::OCURLY);
+    vector<ast::Feature *> features;
+    while (peek() == CoolLexer::OBJECTID)
+    {
+        features.push_back(parse_feature());
+    }
+    expect(CoolLexer::CCURLY);
+
+    return arena_.make<ast::Class>(last_line_, name, parent,
+                                   arena_.copy(features));
+}
+
+ast::Feature *FastCoolParser::parse_feature()
+{
+    auto name = expect_text(CoolLexer::OBJECTID);
+
+    if (peek() == CoolLexer::COLON)
+    {
+        consume();
+        auto type = expect_text(CoolLexer::TYPEID);
+
+        ast::Expr *init = nullptr;
+        if (peek() == CoolLexer::ASSIGN)
+        {
+            consume();
+            init = parse_expression();
+        }
+        expect(CoolLexer::SEMI);
+
+        if (init == nullptr)
+        {
+            init = make_leaf(Kind::NoExpr, {}, last_line_);
+        }
+        return arena_.make<ast::Feature>(Kind::Attr, last_line_, name, type,
+                                         span<ast::Formal *>{}, init);
+    }
+
+    expect(CoolLexer::OPAREN);
+    vector<ast::Formal *> formals;
+    if (peek() != CoolLexer::CPAREN)
+    {
+        formals.push_back(parse_formal());
+        while (peek() == CoolLexer::COMMA)
+        {
+            consume();
+            formals.push_back(parse_formal());
+        }
+    }
+    expect(CoolLexer::CPAREN);
+    expect(CoolLexer::COLON);
+    auto type = expect_text(CoolLexer::TYPEID);
+
+    expect(CoolLexer::OCURLY);
+    auto *body = parse_expression();
+    expect(CoolLexer::CCURLY);
+    expect(CoolLexer::SEMI);
+
+    return arena_.make<ast::Feature>(Kind::Method, last_line_, name, type,
+                                     arena_.copy(formals), body);
+}
+
+ast::Formal *FastCoolParser::parse_formal()
+{
+    auto name = expect_text(CoolLexer::OBJECTID);
+    expect(CoolLexer::COLON);
+    auto type = expect_text(CoolLexer::TYPEID);
+
+    return arena_.make<ast::Formal>(last_line_, name, type);
+}
+
+span<ast::Expr *> FastCoolParser::parse_arguments()
+{
+    expect(CoolLexer::OPAREN);
+    vector<ast::Expr *> arguments;
+    if (peek() != CoolLexer::CPAREN)
+    {
+        arguments.push_back(parse_expression());
+        while (peek() == CoolLexer::COMMA)
+        {
+            consume();
+            arguments.push_back(parse_expression());
+        }
+    }
+    expect(CoolLexer::CPAREN);
+
+    return arena_.copy(arguments);
+}
+
+/// expresion: assign | equal
+ast::Expr *FastCoolParser::parse_expression()
+{
+    if (peek() == CoolLexer::OBJECTID && peek(1) == CoolLexer::ASSIGN)
+    {
+        auto name = arena_.copy(consume()->getText());
+        consume();
+        auto *value = parse_expression();
+
+        return arena_.make<ast::Assign>(ast::Expr{Kind::Assign, last_line_},
+                                        name, value);
+    }
+
+    return parse_comparison(true);
+}
+
+/// equal and greatness: one optional `<`, `<=` or, if `allow_equal`, `=`
+/// between two arithmetic expressions. The operand of `not` is a greatness,
+/// which can't be an `=`.
+ast::Expr *FastCoolParser::parse_comparison(bool allow_equal)
+{
+    auto *left = parse_addition();
+
+    Kind kind;
+    switch (peek())
+    {
+    case CoolLexer::LT:
+        kind = Kind::Lt;
+        break;
+    case CoolLexer::LE:
+        kind = Kind::Le;
+        break;
+    case CoolLexer::EQ:
+        if (!allow_equal)
+        {
+            return left;
+        }
+        kind = Kind::Eq;
+        break;
+    default:
+        return left;
+    }
+
+    consume();
+    auto *right = parse_addition();
+
+    return arena_.make<ast::Binary>(ast::Expr{kind, last_line_}, left, right);
+}
+
+ast::Expr *FastCoolParser::parse_addition()
+{
+    auto *expr = parse_multiplication();
+
+    size_t count = 0;
+    while (peek() == CoolLexer::PLUS || peek() == CoolLexer::MINUS)
+    {
+        auto kind =
+            consume()->getType() == CoolLexer::PLUS ? Kind::Plus : Kind::Sub;
+        auto *right = parse_multiplication();
+        expr = arena_.make<ast::Binary>(ast::Expr{kind, 0}, expr, right);
+        ++count;
+    }
+    set_chain_line(expr, count, last_line_, &ast::Binary::left);
+
+    return expr;
+}
+
+ast::Expr *FastCoolParser::parse_multiplication()
+{
+    auto *expr = parse_unary();
+
+    size_t count = 0;
+    while (peek() == CoolLexer::STAR || peek() == CoolLexer::SLASH)
+    {
+        auto kind =
+            consume()->getType() == CoolLexer::STAR ? Kind::Mul : Kind::Divide;
+        auto *right = parse_unary();
+        expr = arena_.make<ast::Binary>(ast::Expr{kind, 0}, expr, right);
+        ++count;
+    }
+    set_chain_line(expr, count, last_line_, &ast::Binary::left);
+
+    return expr;
+}
+
+/// unaryValue: neg | isvoid | new | not | atom
+ast::Expr *FastCoolParser::parse_unary()
+{
+    Kind kind;
+    switch (peek())
+    {
+    case CoolLexer::TILDE:
+        kind = Kind::Neg;
+        break;
+    case CoolLexer::ISVOID:
+        kind = Kind::Isvoid;
+        break;
+    case CoolLexer::NOT:
+    {
+        consume();
+        auto *operand = parse_comparison(false);
+        return arena_.make<ast::Unary>(ast::Expr{Kind::Comp, last_line_},
+                                       operand);
+    }
+    case CoolLexer::NEW:
+    {
+        consume();
+        auto type = expect_text(CoolLexer::TYPEID);
+        return make_leaf(Kind::New, type, last_line_);
+    }
+    default:
+        return parse_atom();
+    }
+
+    consume();
+    auto *operand = parse_unary();
+    return arena_.make<ast::Unary>(ast::Expr{kind, last_line_}, operand);
+}
+
+/// atom: a primary expression followed by any number of `.f(...)`.
+ast::Expr *FastCoolParser::parse_atom()
+{
+    auto *expr = parse_primary();
+
+    size_t count = 0;
+    while (peek() == CoolLexer::DOT)
+    {
+        consume();
+        auto method = expect_text(CoolLexer::OBJECTID);
+        auto arguments = parse_arguments();
+        expr = arena_.make<ast::Dispatch>(ast::Expr{Kind::Dispatch, 0}, expr,
+                                          string_view{}, method, arguments);
+        ++count;
+    }
+    set_chain_line(expr, count, last_line_, &ast::Dispatch::object);
+
+    return expr;
+}
+
+/// atomWithoutDispatchRec
+ast::Expr *FastCoolParser::parse_primary()
+{
+    switch (peek())
+    {
+    case CoolLexer::INT_CONST:
+    case CoolLexer::STR_CONST:
+    {
+        auto *token = consume();
+        auto kind = token->getType() == CoolLexer::INT_CONST ? Kind::Int
+                                                             : Kind::String;
+        return make_leaf(kind, arena_.copy(token->getText()), last_line_);
+    }
+    case CoolLexer::BOOL_CONST:
+    {
+        auto *token = consume();
+        return arena_.make<ast::Bool>(ast::Expr{Kind::Bool, last_line_},
+                                      token->getText() != "false");
+    }
+    case CoolLexer::OBJECTID:
+    {
+        if (peek(1) == CoolLexer::AT)
+        {
+            auto name = arena_.copy(consume()->getText());
+            auto *object = make_leaf(Kind::Object, name, last_line_);
+            consume();
+            auto type = expect_text(CoolLexer::TYPEID);
+            expect(CoolLexer::DOT);
+            auto method = expect_text(CoolLexer::OBJECTID);
+            auto arguments = parse_arguments();
+
+            return arena_.make<ast::Dispatch>(
+                ast::Expr{Kind::StaticDispatch, last_line_}, object, type,
+                method, arguments);
+        }
+
+        if (peek(1) == CoolLexer::OPAREN)
+        {
+            auto method = arena_.copy(consume()->getText());
+            auto arguments = parse_arguments();
+            auto *self = make_leaf(Kind::Object, "self", last_line_);
+
+            return arena_.make<ast::Dispatch>(
+                ast::Expr{Kind::Dispatch, last_line_}, self, string_view{},
+                method, arguments);
+        }
+
+        auto name = arena_.copy(consume()->getText());
+        return make_leaf(Kind::Object, name, last_line_);
+    }
+    case CoolLexer::OCURLY:
+    {
+        consume();
+        vector<ast::Expr *> body;
+        do
+        {
+            body.push_back(parse_expression());
+            expect(CoolLexer::SEMI);
+        } while (peek() != CoolLexer::CCURLY);
+        consume();
+
+        return arena_.make<ast::Block>(ast::Expr{Kind::Block, last_line_},
+                                       arena_.copy(body));
+    }
+    case CoolLexer::LET:
+        return parse_let();
+    case CoolLexer::IF:
+    {
+        consume();
+        auto *predicate = parse_expression();
+        expect(CoolLexer::THEN);
+        auto *then_branch = parse_expression();
+        expect(CoolLexer::ELSE);
+        auto *else_branch = parse_expression();
+        expect(CoolLexer::FI);
+
+        return arena_.make<ast::Cond>(ast::Expr{Kind::Cond, last_line_},
+                                      predicate, then_branch, else_branch);
+    }
+    case CoolLexer::WHILE:
+    {
+        consume();
+        auto *predicate = parse_expression();
+        expect(CoolLexer::LOOP);
+        auto *body = parse_expression();
+        expect(CoolLexer::POOL);
+
+        return arena_.make<ast::Loop>(ast::Expr{Kind::Loop, last_line_},
+                                      predicate, body);
+    }
+    case CoolLexer::CASE:
+        return parse_typcase();
+    case CoolLexer::OPAREN:
+    {
+        consume();
+        auto *expr = parse_expression();
+        expect(CoolLexer::CPAREN);
+        return expr;
+    }
+    default:
+        throw Bail{};
+    }
+}
+
+/// letIn: one ast::Let per variable, each nested in the previous one.
+ast::Expr *FastCoolParser::parse_let()
+{
+    expect(CoolLexer::LET);
+
+    vector<ast::Let *> lets;
+    while (true)
+    {
+        auto name = expect_text(CoolLexer::OBJECTID);
+        expect(CoolLexer::COLON);
+        auto type = expect_text(CoolLexer::TYPEID);
+
+        ast::Expr *init;
+        if (peek() == CoolLexer::ASSIGN)
+        {
+            consume();
+            init = parse_expression();
+        }
+        else
+        {
+            init = make_leaf(Kind::NoExpr, {}, last_line_);
+        }
+        lets.push_back(arena_.make<ast::Let>(ast::Expr{Kind::Let, 0}, name,
+                                             type, init, nullptr));
+
+        if (peek() != CoolLexer::COMMA)
+        {
+            break;
+        }
+        consume();
+    }
+
+    expect(CoolLexer::IN);
+    ast::Expr *body = parse_expression();
+
+    // Like the operators of a chain, every variable is shown on the line of
+    // the end of the whole `let`.
+    for (auto it = lets.rbegin(); it != lets.rend(); ++it)
+    {
+        (*it)->line = last_line_;
+        (*it)->body = body;
+        body = *it;
+    }
+
+    return body;
+}
+
+ast::Expr *FastCoolParser::parse_typcase()
+{
+    expect(CoolLexer::CASE);
+    auto *scrutinee = parse_expression();
+    expect(CoolLexer::OF);
+
+    vector<ast::Branch *> branches;
+    do
+    {
+        auto name = expect_text(CoolLexer::OBJECTID);
+        expect(CoolLexer::COLON);
+        auto type = expect_text(CoolLexer::TYPEID);
+        expect(CoolLexer::DARROW);
+        auto *body = parse_expression();
+        expect(CoolLexer::SEMI);
+
+        branches.push_back(
+            arena_.make<ast::Branch>(last_line_, name, type, body));
+    } while (peek() == CoolLexer::OBJECTID);
+    expect(CoolLexer::ESAC);
+
+    return arena_.make<ast::Typcase>(ast::Expr{Kind::Typcase, last_line_},
+                                     scrutinee, arena_.copy(branches));
+}
+
+namespace
+{
+
+class AstPrinter
+{
+private:
+    string_view file_name_;
+    string out_;
+    size_t indent_ = 0;
+
+    void print_line(string_view text)
+    {
+        out_.append(indent_, ' ');
+        out_.append(text);
+        out_.push_back('\n');
+    }
+
+    void print_row(size_t line)
+    {
+        out_.append(indent_, ' ');
+        out_.push_back('#');
+        out_.append(to_string(line));
+        out_.push_back('\n');
+    }
+
+    static string_view label(Kind kind)
+    {
+        // clang-format off
+        switch (kind) {
+            case Kind::Assign         : return "_assign";
+            case Kind::StaticDispatch : return "_static_dispatch";
+            case Kind::Dispatch       : return "_dispatch";
+            case Kind::Cond           : return "_cond";
+            case Kind::Loop           : return "_loop";
+            case Kind::Typcase        : return "_typcase";
+            case Kind::Block          : return "_block";
+            case Kind::Let            : return "_let";
+            case Kind::Plus           : return "_plus";
+            case Kind::Sub            : return "_sub";
+            case Kind::Mul            : return "_mul";
+            case Kind::Divide         : return "_divide";
+            case Kind::Neg            : return "_neg";
+            case Kind::Lt             : return "_lt";
+            case Kind::Eq             : return "_eq";
+            case Kind::Le             : return "_le";
+            case Kind::Comp           : return "_comp";
+            case Kind::Int            : return "_int";
+            case Kind::String         : return "_string";
+            case Kind::Bool           : return "_bool";
+            case Kind::New            : return "_new";
+            case Kind::Isvoid         : return "_isvoid";
+            case Kind::NoExpr         : return "_no_expr";
+            case Kind::Object         : return "_object";
+            case Kind::Attr           : return "_attr";
+            case Kind::Method         : return "_method";
+            case Kind::Formal         : return "_formal";
+            case Kind::Branch         : return "_branch";
+            case Kind::Class          : return "_class";
+            case Kind::Program        : return "_program";
+        }
+        // clang-format on
+        return "";
+    }
+
+    void print_arguments(span<ast::Expr *> arguments)
+    {
+        print_line("(");
+        for (auto *argument : arguments)
+        {
+            print_expr(argument);
+        }
+        print_line(")");
+    }
+
+    void print_expr(const ast::Expr *expr)
+    {
+        print_row(expr->line);
+        print_line(label(expr->kind));
+
+        if (expr->kind == Kind::NoExpr)
+        {
+            print_line(": _no_type");
+            return;
+        }
+
+        indent_ += 2;
+        switch (expr->kind)
+        {
+        case Kind::Int:
+        case Kind::String:
+        case Kind::New:
+        case Kind::Object:
+            print_line(static_cast<const ast::Leaf *>(expr)->text);
+            break;
+        case Kind::Bool:
+            print_line(static_cast<const ast::Bool *>(expr)->value ? "1" : "0");
+            break;
+        case Kind::Neg:
+        case Kind::Comp:
+        case Kind::Isvoid:
+            print_expr(static_cast<const ast::Unary *>(expr)->operand);
+            break;
+        case Kind::Plus:
+        case Kind::Sub:
+        case Kind::Mul:
+        case Kind::Divide:
+        case Kind::Lt:
+        case Kind::Le:
+        case Kind::Eq:
+        {
+            auto *binary = static_cast<const ast::Binary *>(expr);
+            print_expr(binary->left);
+            print_expr(binary->right);
+            break;
+        }
+        case Kind::Assign:
+        {
+            auto *assign = static_cast<const ast::Assign *>(expr);
+            print_line(assign->name);
+            print_expr(assign->value);
+            break;
+        }
+        case Kind::StaticDispatch:
+        case Kind::Dispatch:
+        {
+            auto *dispatch = static_cast<const ast::Dispatch *>(expr);
+            print_expr(dispatch->object);
+            if (expr->kind == Kind::StaticDispatch)
+            {
+                print_line(dispatch->static_type);
+            }
+            print_line(dispatch->method);
+            print_arguments(dispatch->arguments);
+            break;
+        }
+        case Kind::Cond:
+        {
+            auto *cond = static_cast<const ast::Cond *>(expr);
+            print_expr(cond->predicate);
+            print_expr(cond->then_branch);
+            print_expr(cond->else_branch);
+            break;
+        }
+        case Kind::Loop:
+        {
+            auto *loop = static_cast<const ast::Loop *>(expr);
+            print_expr(loop->predicate);
+            print_expr(loop->body);
+            break;
+        }
+        case Kind::Block:
+            for (auto *body : static_cast<const ast::Block *>(expr)->body)
+            {
+                print_expr(body);
+            }
+            break;
+        case Kind::Let:
+        {
+            auto *let = static_cast<const ast::Let *>(expr);
+            print_line(let->name);
+            print_line(let->type);
+            print_expr(let->init);
+            print_expr(let->body);
+            break;
+        }
+        case Kind::Typcase:
+        {
+            auto *typcase = static_cast<const ast::Typcase *>(expr);
+            print_expr(typcase->scrutinee);
+            for (auto *branch : typcase->branches)
+            {
+                print_row(branch->line);
+                print_line("_branch");
+                indent_ += 2;
+                print_line(branch->name);
+                print_line(branch->type);
+                print_expr(branch->body);
+                indent_ -= 2;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        indent_ -= 2;
+
+        print_line(": _no_type");
+    }
+
+    void print_feature(const ast::Feature *feature)
+    {
+        print_row(feature->line);
+        print_line(label(feature->kind));
+        indent_ += 2;
+
+        print_line(feature->name);
+        if (feature->kind == Kind::Attr)
+        {
+            print_line(feature->type);
+            print_expr(feature->body);
+        }
+        else
+        {
+            for (auto *formal : feature->formals)
+            {
+                print_row(formal->line);
+                print_line("_formal");
+                indent_ += 2;
+                print_line(formal->name);
+                print_line(formal->type);
+                indent_ -= 2;
+            }
+            print_line(feature->type);
+            print_expr(feature->body);
+        }
+
+        indent_ -= 2;
+    }
+
+public:
+    explicit AstPrinter(string_view file_name) : file_name_(file_name) {}
+
+    string print(const ast::Program &program)
+    {
+        print_row(program.line);
+        print_line("_program");
+        indent_ += 2;
+
+        for (auto *cls : program.classes)
+        {
+            print_row(cls->line);
+            print_line("_class");
+            indent_ += 2;
+
+            print_line(cls->name);
+            print_line(cls->parent);
+            print_line("\"" + string(file_name_) + '"');
+            print_line("(");
+            for (auto *feature : cls->features)
+            {
+                print_feature(feature);
+            }
+            print_line(")");
+
+            indent_ -= 2;
+        }
+
+        indent_ -= 2;
+        return std::move(out_);
+    }
+};
+
+} // namespace
+
+string format_ast(const ast::Program &program, string_view file_name)
+{
+    return AstPrinter(file_name).print(program);
+}
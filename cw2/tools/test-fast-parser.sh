@@ -0,0 +1,93 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+script_dir="$(cd -- "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+project_root="$(cd -- "${script_dir}/.." && pwd)"
+tests_dir="${project_root}/tests/parser"
+bin_dir="${project_root}/build"
+temp_dir="${project_root}/temp"
+
+mkdir -p "${temp_dir}"
+
+# Checks that `parser --fast-parser` prints exactly what the ANTLR parser
+# prints, for correct programs and for programs with syntax errors, which the
+# fast parser leaves to the ANTLR parser. Programs the fast parser handles are
+# also written with --emit-binary-ast and printed back with --read-binary-ast.
+# A test FAILS if any of the outputs differ; how many programs the fast parser
+# handled itself is reported at the end.
+#
+# Args-
+#   input/prefix : optional test file path or prefix
+input="${1:-}"
+
+if [ ! -f "${bin_dir}/parser" ]; then
+    echo "Error: Parser not found in ${bin_dir}/parser; build it first and then test" >&2
+    exit 1
+fi
+
+run_test() {
+    local in_path="$1"
+    local testname antlr_path fast_path binary_path stats diff_output
+
+    testname="$(basename "${in_path}" .in)"
+    antlr_path="${temp_dir}/${testname}.antlr.sol"
+    fast_path="${temp_dir}/${testname}.fast.sol"
+    binary_path="${temp_dir}/${testname}.ast"
+
+    total_tests=$((total_tests + 1))
+
+    "${bin_dir}/parser" "${in_path}" > "${antlr_path}"
+    stats=$("${bin_dir}/parser" --fast-parser --parse-stats "${in_path}" 2>&1 > "${fast_path}")
+
+    if ! diff_output=$(diff "${antlr_path}" "${fast_path}"); then
+        echo "Test ${testname} FAILED"
+        echo "diff between the ANTLR and the fast parser is:"
+        echo "${diff_output}"
+        return
+    fi
+
+    if [[ "${stats}" == *"fast parser"* ]]; then
+        "${bin_dir}/parser" --emit-binary-ast "${binary_path}" "${in_path}"
+        if ! diff_output=$(diff "${antlr_path}" \
+                <("${bin_dir}/parser" --read-binary-ast "${binary_path}")); then
+            echo "Test ${testname} FAILED"
+            echo "diff between the ANTLR parser and the binary AST is:"
+            echo "${diff_output}"
+            return
+        fi
+        fast_tests=$((fast_tests + 1))
+    fi
+
+    passed_tests=$((passed_tests + 1))
+    echo "Test ${testname} PASSED"
+}
+
+# === Test counters ===
+total_tests=0
+passed_tests=0
+fast_tests=0
+
+if [ -z "$input" ]; then
+    for in_path in "${tests_dir}"/*.in; do
+        run_test "${in_path}"
+    done
+elif [ -e "$input" ]; then
+    run_test "$input"
+else
+    matches=( "${tests_dir}/${input}"*.in )
+
+    if [ -e "${matches[0]}" ]; then
+        for in_path in "${matches[@]}"; do
+            run_test "${in_path}"
+        done
+    else
+        echo "Error: '${input}' is not a valid file name or prefix"
+        echo "Usage: $0 [input|prefix]"
+        exit 1
+    fi
+fi
+
+# === Print summary ===
+echo
+echo "Total ${passed_tests} out of ${total_tests} tests PASSED"
+echo "${fast_tests} of them were parsed by the fast parser"
@@ -0,0 +1,45 @@
+#ifndef BENCH_PROGRAM_GENERATOR_H_
+#define BENCH_PROGRAM_GENERATOR_H_
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Kinds of synthetic COOL programs, each of which stresses one dimension of
+// the compiler. The size parameter of each shape scales that dimension and
+// nothing else.
+enum class ProgramShape {
+    // `size` unrelated classes with a few attributes and methods each.
+    ManyClasses,
+    // An inheritance chain `size` classes deep in which every method reads
+    // attributes declared further up the chain.
+    DeepInheritance,
+    // A single method whose body is a block of `size` expressions.
+    LongMethod,
+    // `let` expressions nested `size` levels deep.
+    NestedLet,
+    // `case` expressions nested `size` levels deep.
+    NestedCase,
+    // One `case` with a branch for each of `size` classes.
+    WideCase,
+    // `size` distinct string literals.
+    StringTable,
+};
+
+struct ShapeInfo {
+    ProgramShape shape;
+    std::string_view name;
+    // Largest size the benchmark runs the shape at.
+    size_t default_size;
+};
+
+std::span<const ShapeInfo> all_program_shapes();
+
+std::optional<ProgramShape> program_shape_from_name(std::string_view name);
+
+// Returns the source of a valid COOL program of the given shape.
+std::string generate_program(ProgramShape shape, size_t size);
+
+#endif
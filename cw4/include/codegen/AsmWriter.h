@@ -0,0 +1,113 @@
+#ifndef CODEGEN_ASM_WRITER_H_
+#define CODEGEN_ASM_WRITER_H_
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sink for the generated assembly. Text is appended into large fixed-size
+// chunks and handed to the kernel with a single `writev` once enough chunks
+// have filled up, so emitting an instruction is a couple of memcpys rather
+// than a trip through an ostream and a flush per line.
+//
+// Integers are formatted in place with `std::to_chars`; nothing on the
+// emitting path allocates once the chunks are warm.
+//
+// A default-constructed writer has no file descriptor and keeps everything in
+// memory until `take_text` is called.
+class AsmWriter {
+  public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t CHUNKS_PER_WRITE = 16;
+
+  private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    int fd_ = -1;
+    bool failed_ = false;
+
+    // The last chunk is the one being filled; `cursor_`/`limit_` point into it.
+    std::vector<Chunk> chunks_;
+    std::vector<std::unique_ptr<char[]>> spare_chunks_;
+
+    char *cursor_ = nullptr;
+    char *limit_ = nullptr;
+
+    void start_chunk();
+    void next_chunk();
+    void write_chunks();
+    void write_slow(std::string_view text);
+
+  public:
+    AsmWriter();
+    explicit AsmWriter(int fd);
+    ~AsmWriter();
+
+    AsmWriter(const AsmWriter &) = delete;
+    AsmWriter &operator=(const AsmWriter &) = delete;
+
+    void write(std::string_view text) {
+        if (text.size() <= static_cast<size_t>(limit_ - cursor_)) {
+            std::memcpy(cursor_, text.data(), text.size());
+            cursor_ += text.size();
+            return;
+        }
+        write_slow(text);
+    }
+
+    void put(char c) {
+        if (cursor_ == limit_) {
+            next_chunk();
+        }
+        *cursor_++ = c;
+    }
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool> && !std::same_as<T, char>)
+    void write_int(T value) {
+        // Enough for any 64-bit integer including the sign.
+        constexpr ptrdiff_t MAX_DIGITS = 21;
+        if (limit_ - cursor_ < MAX_DIGITS) {
+            next_chunk();
+        }
+        cursor_ = std::to_chars(cursor_, limit_, value).ptr;
+    }
+
+    AsmWriter &operator<<(std::string_view text) {
+        write(text);
+        return *this;
+    }
+
+    AsmWriter &operator<<(char c) {
+        put(c);
+        return *this;
+    }
+
+    template <std::integral T>
+        requires(!std::same_as<T, bool> && !std::same_as<T, char>)
+    AsmWriter &operator<<(T value) {
+        write_int(value);
+        return *this;
+    }
+
+    // Hands everything buffered so far to the kernel. Does nothing for an
+    // in-memory writer.
+    void flush();
+
+    // Returns everything written so far and empties the writer. Only makes
+    // sense for an in-memory writer.
+    std::string take_text();
+
+    // False once a write to the file descriptor has failed.
+    bool good() const { return !failed_; }
+};
+
+#endif
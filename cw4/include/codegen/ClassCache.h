@@ -0,0 +1,61 @@
+#ifndef CODEGEN_CLASS_CACHE_H_
+#define CODEGEN_CLASS_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "antlr4-runtime.h"
+#include "StaticConstants.h"
+
+// On-disk cache of the code generated for single classes. Entries are keyed
+// by a hash of everything that code depends on (see CoolCodegen), so a hit
+// can be pasted into the output as is.
+//
+// Safe to share between threads and processes: entries are written to a
+// temporary file and renamed into place.
+class ClassCache
+{
+public:
+    struct Entry
+    {
+        StaticConstants::Uses constants;
+        string methods; // the class's method implementations
+        string init;    // the class's _init routine
+    };
+
+private:
+    filesystem::path directory_;
+    uint64_t compiler_stamp_;
+
+    atomic<size_t> hits_ = 0;
+    atomic<size_t> misses_ = 0;
+    atomic<size_t> next_temp_id_ = 0;
+
+    filesystem::path path_for(uint64_t key) const;
+
+public:
+    explicit ClassCache(filesystem::path directory);
+
+    // Identifies the compiler binary, so that entries written by a different
+    // build of the code generator are never used.
+    uint64_t get_compiler_stamp() const { return compiler_stamp_; }
+
+    optional<Entry> load(uint64_t key);
+    void store(uint64_t key, const Entry &entry);
+
+    size_t get_hits() const { return hits_; }
+    size_t get_misses() const { return misses_; }
+
+    // Hashes the tokens of every top-level class declaration, by class name.
+    // Only the line numbers of `case` tokens are included, because those are
+    // the only ones that end up in the generated code.
+    static unordered_map<string, uint64_t>
+    hash_class_sources(const vector<antlr4::Token *> &tokens);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CODEGEN_CODEGEN_CONTEXT_H_
+#define CODEGEN_CODEGEN_CONTEXT_H_
+
+#include <string>
+
+// State that lives for the duration of one compilation and is shared by all
+// code generators working on it. Keeping it out of globals is what lets
+// several programs be compiled in the same process at once.
+struct CodegenContext {
+    // Label of the routine being generated. Local labels are qualified with
+    // it and numbered from zero in every routine, so the code of a routine
+    // does not depend on what was generated before it.
+    std::string routine_label;
+
+    // Counters used to make the labels of control-flow constructs unique.
+    int if_then_else_fi_label_count = 0;
+    int while_loop_pool_label_count = 0;
+    int case_of_esac_count = 0;
+
+    void begin_routine(std::string label) {
+        routine_label = std::move(label);
+        if_then_else_fi_label_count = 0;
+        while_loop_pool_label_count = 0;
+        case_of_esac_count = 0;
+    }
+};
+
+#endif
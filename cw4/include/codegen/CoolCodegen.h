@@ -1,12 +1,17 @@
 #ifndef CODEGEN_COOL_CODEGEN_H_
 #define CODEGEN_COOL_CODEGEN_H_
 
+#include <cstdint>
 #include <memory>
-#include <ostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "AsmWriter.h"
+#include "ClassCache.h"
+#include "CodegenContext.h"
 #include "CoolParser.h"
+#include "debug/PhaseTimer.h"
 #include "semantics/ClassTable.h"
 #include "StaticConstants.h"
 #include "ExpressionCodegen.h"
@@ -16,43 +21,82 @@ using namespace std;
 class CoolCodegen
 {
 private:
+    struct CachedClass
+    {
+        uint64_t key;
+        bool hit;
+        ClassCache::Entry entry;
+    };
+
+    CodegenContext context_;
     StaticConstants static_constants_;
     ExpressionCodegen expression_codegen_;
 
     string file_name_;
     unique_ptr<ClassTable> class_table_;
 
-    void emit_methods(ostream &out);
+    bool release_bodies_ = false;
+
+    ClassCache *class_cache_ = nullptr;
+    unordered_map<string, uint64_t> class_source_hashes_;
+    uint64_t layout_hash_ = 0;
+    unordered_map<int, CachedClass> cached_classes_;
+
+    // Code of classes that miss the cache is generated here first, so that it
+    // can be stored as well as written out.
+    AsmWriter scratch_;
+
+    uint64_t compute_layout_hash();
+    CachedClass *look_up_cached_class(int class_index, const string &class_name);
 
-    void emit_tables(ostream &out);
-    void emit_name_table(ostream &out, vector<string> &class_names);
-    void emit_className_attributes(ostream &out, const string &class_name);
-    void emit_length_attribute(ostream &out, const string &class_name);
-    void emit_className(ostream &out, const string &class_name);
+    void release_method_bodies(int class_index);
+    void release_attribute_initializers(int class_index, const string &class_name);
 
-    void emit_prototype_tables(ostream &out, vector<string> &class_names);
-    void emit_prototype_table(ostream &out, const string &class_name);
+    void emit_methods(AsmWriter &out);
+    void emit_class_methods(AsmWriter &out, int class_index, const string &class_name);
 
-    void emit_dispatch_tables(ostream &out, vector<string> &class_names, vector<string> &base_class_names);
-    void emit_dispatch_table(ostream &out, const string &class_name, vector<string> &base_class_names);
+    void emit_tables(AsmWriter &out);
+    void emit_name_table(AsmWriter &out, vector<string> &class_names);
+    void emit_className_attributes(AsmWriter &out, const string &class_name);
+    void emit_length_attribute(AsmWriter &out, const string &class_name);
+    void emit_className(AsmWriter &out, const string &class_name);
 
-    void emit_initialization_methods(ostream &out, vector<string> &class_names);
+    void emit_prototype_tables(AsmWriter &out, vector<string> &class_names);
+    void emit_prototype_table(AsmWriter &out, const string &class_name);
 
-    void emit_class_object_table(ostream &out, vector<string> &class_names);
+    void emit_dispatch_tables(AsmWriter &out, vector<string> &class_names, vector<string> &base_class_names);
+    void emit_dispatch_table(AsmWriter &out, const string &class_name, vector<string> &base_class_names);
+
+    void emit_initialization_methods(AsmWriter &out, vector<string> &class_names);
+    void emit_initialization_method(AsmWriter &out, int class_index, const string &cls);
+
+    void emit_class_object_table(AsmWriter &out, vector<string> &class_names);
 
 public:
     CoolCodegen(string file_name, unique_ptr<ClassTable> class_table)
         : file_name_(move(file_name)),
           class_table_(move(class_table)),
           static_constants_(),
-          expression_codegen_(&static_constants_)
+          expression_codegen_(&context_, &static_constants_)
     {
         expression_codegen_.set_class_table(class_table_.get());
         expression_codegen_.set_file_name(file_name_);
         static_constants_.set_class_table(class_table_.get());
     }
 
-    void generate(ostream &out);
+    // Frees the typed body of each method and attribute initializer as soon
+    // as the code for it has been emitted, so the typed AST of the program is
+    // never alive in full while the output is being written.
+    void release_bodies_after_use(bool release) { release_bodies_ = release; }
+
+    // Takes the methods and `_init` routines of classes whose source is
+    // unchanged from `class_cache`, and stores those of the other classes.
+    // `class_source_hashes` comes from `ClassCache::hash_class_sources`.
+    // String constants are then named after their contents, not numbered.
+    void use_class_cache(ClassCache *class_cache, unordered_map<string, uint64_t> class_source_hashes);
+
+    // `timer`, if given, receives one phase per step of the backend.
+    void generate(AsmWriter &out, PhaseTimer *timer = nullptr);
 };
 
 #endif
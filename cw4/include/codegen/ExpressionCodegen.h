@@ -1,10 +1,12 @@
 #ifndef CODEGEN_COOL_EXPRESSION_CODEGEN_H_
 #define CODEGEN_COOL_EXPRESSION_CODEGEN_H_
 
-#include <ostream>
+#include "AsmWriter.h"
+#include "CodegenContext.h"
 #include "StaticConstants.h"
 #include "Register.h"
 #include "semantics/ClassTable.h"
+#include "util/SymbolTable.h"
 
 #include "semantics/typed-ast/Expr.h"
 #include "semantics/typed-ast/StaticDispatch.h"
@@ -29,60 +31,92 @@
 #include "semantics/typed-ast/ParenthesizedExpr.h"
 #include "semantics/typed-ast/CaseOfEsac.h"
 
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
 using namespace std;
 
 class ExpressionCodegen
 {
 private:
+    CodegenContext *context_;
     StaticConstants *static_constants_;
     ClassTable *class_table_;
     int current_class_index_ = 0;
     string file_name_;
 
-    void emit_static_dispatch(ostream &out, const StaticDispatch *static_dispatch);
-    void emit_string_constant(ostream &out, const StringConstant *string_constant);
-    void emit_let_in(ostream &out, const LetIn *let_in);
-    void emit_new_object(ostream &out, const NewObject *new_object);
-    void emit_dynamic_dispatch(ostream &out, const DynamicDispatch *dynamic_dispatch);
-    void emit_object_reference(ostream &out, const ObjectReference *object_reference);
-    void emit_sequence(ostream &out, const Sequence *sequence);
-    void emit_int_constant(ostream &out, const IntConstant *int_constant);
-    void emit_assignment(ostream &out, const Assignment *assignment);
-    void emit_method_invocation(ostream &out, const MethodInvocation *method_invocation);
-    void emit_if_then_else_fi(ostream &out, const IfThenElseFi *if_then_else_fi);
-    void emit_bool_constant(ostream &out, const BoolConstant *bool_constant);
-    void emit_is_void(ostream &out, const IsVoid *is_void);
-    void emit_integer_comparison(ostream &out, const IntegerComparison *integer_comparison);
-    void emit_equality_comparison(ostream &out, const EqualityComparison *equality_comparison);
-    void emit_while_loop_pool(ostream &out, const WhileLoopPool *while_loop_pool);
-    void emit_integer_negation(ostream &out, const IntegerNegation *integer_negation);
-    void emit_boolean_negation(ostream &out, const BooleanNegation *boolean_negation);
-    void emit_arithmetic(ostream &out, const Arithmetic *arithmetic);
-    void emit_parenthesized_expr(ostream &out, const ParenthesizedExpr *parenthesized_expr);
-    void emit_case_of_esac(ostream &out, const CaseOfEsac *case_of_esac);
+    void emit_static_dispatch(AsmWriter &out, const StaticDispatch *static_dispatch);
+    void emit_string_constant(AsmWriter &out, const StringConstant *string_constant);
+    void emit_let_in(AsmWriter &out, const LetIn *let_in);
+    void emit_new_object(AsmWriter &out, const NewObject *new_object);
+    void emit_dynamic_dispatch(AsmWriter &out, const DynamicDispatch *dynamic_dispatch);
+    void emit_object_reference(AsmWriter &out, const ObjectReference *object_reference);
+    void emit_sequence(AsmWriter &out, const Sequence *sequence);
+    void emit_int_constant(AsmWriter &out, const IntConstant *int_constant);
+    void emit_assignment(AsmWriter &out, const Assignment *assignment);
+    void emit_method_invocation(AsmWriter &out, const MethodInvocation *method_invocation);
+    void emit_if_then_else_fi(AsmWriter &out, const IfThenElseFi *if_then_else_fi);
+    void emit_bool_constant(AsmWriter &out, const BoolConstant *bool_constant);
+    void emit_is_void(AsmWriter &out, const IsVoid *is_void);
+    void emit_integer_comparison(AsmWriter &out, const IntegerComparison *integer_comparison);
+    void emit_equality_comparison(AsmWriter &out, const EqualityComparison *equality_comparison);
+    void emit_while_loop_pool(AsmWriter &out, const WhileLoopPool *while_loop_pool);
+    void emit_integer_negation(AsmWriter &out, const IntegerNegation *integer_negation);
+    void emit_boolean_negation(AsmWriter &out, const BooleanNegation *boolean_negation);
+    void emit_arithmetic(AsmWriter &out, const Arithmetic *arithmetic);
+    void emit_parenthesized_expr(AsmWriter &out, const ParenthesizedExpr *parenthesized_expr);
+    void emit_case_of_esac(AsmWriter &out, const CaseOfEsac *case_of_esac);
+
+    // Label for the `id`-th construct of its kind in the current routine.
+    string local_label(string_view kind, int id) const
+    {
+        return context_->routine_label + "." + string(kind) + to_string(id);
+    }
 
     string get_file_name_label()
     {
         return static_constants_->use_string_constant(file_name_);
     }
 
-    void push_register(ostream &out, Register reg);
+    void push_register(AsmWriter &out, Register reg);
     void pop_register(int words_count = 1);
-    void pop_words(ostream &out, int words_count);
+    void pop_words(AsmWriter &out, int words_count);
 
     int frame_depth_bytes_ = 8;
-    vector<unordered_map<string, int>> scopes_;
 
-    void bind_var(const string &name, int fp_offset);
-    int lookup_var(const string &name);
+    // Variables in scope, innermost last, and where each scope starts among
+    // them. Scopes are a handful of variables deep, so a backwards scan over
+    // integer symbols beats hashing the name once per scope.
+    vector<pair<Symbol, int>> bindings_;
+    vector<size_t> scope_starts_;
+
+    // The names this compilation has seen. Each name is interned once, at the
+    // node codegen reads it from; from there on only symbols are compared.
+    SymbolTable symbols_;
+
+    // The slot of every attribute of each class, inherited ones included,
+    // filled in the first time the class is looked at. A hash map rather than
+    // a vector indexed by symbol, so that a program with many classes and
+    // many names doesn't need a table of their product.
+    vector<optional<unordered_map<Symbol, int>>> attribute_slots_;
+    Symbol self_symbol_;
+
+    void bind_var(Symbol name, int fp_offset);
+    int lookup_var(Symbol name) const;
+
+    // Returns the slot of the attribute in objects of the class, or -1.
+    int get_attribute_slot(int class_index, Symbol name);
 
 public:
-    ExpressionCodegen(StaticConstants *static_constants)
-        : static_constants_(static_constants) {}
+    ExpressionCodegen(CodegenContext *context, StaticConstants *static_constants)
+        : context_(context), static_constants_(static_constants),
+          self_symbol_(symbols_.intern("self")) {}
 
     void set_class_table(ClassTable *class_table)
     {
         class_table_ = class_table;
+        attribute_slots_.clear();
     }
 
     void set_file_name(const string &file_name)
@@ -95,8 +129,8 @@ public:
         current_class_index_ = class_index;
     }
 
-    void generate(ostream &out, const Expr *expr);
-    void emit_attributes(ostream &out, const vector<string> &attribute_names, int class_index);
+    void generate(AsmWriter &out, const Expr *expr);
+    void emit_attributes(AsmWriter &out, const vector<string> &attribute_names, int class_index);
     void bind_formals(const vector<string> &formals);
     void begin_scope();
     void end_scope();
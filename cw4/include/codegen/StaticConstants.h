@@ -1,22 +1,41 @@
 #ifndef CODEGEN_COOL_STATIC_CONSTANTS_H_
 #define CODEGEN_COOL_STATIC_CONSTANTS_H_
 
+#include "AsmWriter.h"
 #include "semantics/ClassTable.h"
 
 #include <memory>
-#include <ostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
 class StaticConstants
 {
+public:
+    // The constants some piece of code asked for. Code taken from the class
+    // cache instead of being generated replays these, so that the constants
+    // it refers to still get emitted.
+    struct Uses
+    {
+        // Each string with the label the code refers to it by.
+        vector<pair<string, string>> strings;
+        vector<int> ints;
+        bool true_used = false;
+        bool false_used = false;
+    };
+
 private:
     ClassTable *class_table_;
+    Uses *recording_ = nullptr;
 
+    // Without content labels, strings are numbered in the order of first use.
+    bool content_labels_ = false;
     int next_string_id = 0;
     unordered_map<string, string> string_to_label;
+    unordered_map<string, string> label_to_string;
 
     bool is_true_used = false;
     bool is_false_used = false;
@@ -33,12 +52,27 @@ public:
         class_table_ = class_table;
     }
 
+    // Names string constants after a hash of their contents instead of the
+    // order of first use, so that the labels in cached code don't depend on
+    // what was generated before it. Must be called before any constant is
+    // used.
+    void use_content_labels() { content_labels_ = true; }
+
     string use_string_constant(const string &str);
     string use_bool_constant(bool value);
     string use_int_constant(int value);
     string use_default_value(string class_name);
 
-    void emit_all(ostream &out);
+    // Records every constant used until `stop_recording` into `uses`.
+    void start_recording(Uses *uses) { recording_ = uses; }
+    void stop_recording() { recording_ = nullptr; }
+
+    // Uses the constants again, with the same labels. Returns false, and uses
+    // nothing, if a label is already taken by another string, in which case
+    // the code that recorded `uses` can't be reused.
+    bool replay(const Uses &uses);
+
+    void emit_all(AsmWriter &out);
 };
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef DEBUG_PARSE_CLOCK_H_
+#define DEBUG_PARSE_CLOCK_H_
+
+#include <chrono>
+
+#include "CoolParser.h"
+#include "antlr4-runtime.h"
+
+#include "debug/PhaseTimer.h"
+
+// Measures the time spent in the `program` rule, which is the whole parse.
+// Semantics parses the token stream itself, so this is the only way to time
+// the parse it does without parsing a second time. A first SLL attempt that
+// gives up still leaves the rule, so both attempts are counted.
+//
+// Attach it with `addParseListener` and hand the result to
+// `PhaseTimer::split_off` once the phase that ran the parse has ended.
+class ParseClock : public antlr4::tree::ParseTreeListener {
+  private:
+    std::chrono::steady_clock::time_point start_;
+    unsigned long long start_allocations_ = 0;
+
+  public:
+    double wall_ms = 0;
+    unsigned long long allocations = 0;
+
+    void enterEveryRule(antlr4::ParserRuleContext *ctx) override {
+        if (ctx->getRuleIndex() == CoolParser::RuleProgram) {
+            start_allocations_ = allocation_count();
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    void exitEveryRule(antlr4::ParserRuleContext *ctx) override {
+        if (ctx->getRuleIndex() == CoolParser::RuleProgram) {
+            std::chrono::duration<double, std::milli> wall =
+                std::chrono::steady_clock::now() - start_;
+            wall_ms += wall.count();
+            allocations += allocation_count() - start_allocations_;
+        }
+    }
+
+    void visitTerminal(antlr4::tree::TerminalNode *) override {}
+    void visitErrorNode(antlr4::tree::ErrorNode *) override {}
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef DEBUG_PHASE_TIMER_H_
+#define DEBUG_PHASE_TIMER_H_
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Collects wall time, heap allocation count and peak RSS for each phase of a
+// compilation. Phases are recorded in the order in which they finish.
+class PhaseTimer {
+  public:
+    struct Phase {
+        std::string name;
+        double wall_ms;
+        unsigned long long allocations;
+        long peak_rss_kb;
+    };
+
+  private:
+    std::vector<Phase> phases_;
+
+    std::string current_name_;
+    std::chrono::steady_clock::time_point current_start_;
+    unsigned long long current_allocations_ = 0;
+
+  public:
+    void begin(std::string name);
+    void end();
+
+    // Moves `wall_ms` and `allocations` out of the last phase into a new
+    // phase called `name`, recorded just before it. For work that can only be
+    // measured from inside another phase.
+    void split_off(std::string name, double wall_ms,
+                   unsigned long long allocations);
+
+    const std::vector<Phase> &get_phases() const { return phases_; }
+
+    void print_text(std::ostream &out) const;
+    void print_json(std::ostream &out, const std::string &file_name) const;
+};
+
+// Times the enclosing scope as one phase. Does nothing if `timer` is null, so
+// call sites don't need to care whether a report was requested.
+class PhaseScope {
+  private:
+    PhaseTimer *timer_;
+
+  public:
+    PhaseScope(PhaseTimer *timer, std::string name) : timer_(timer) {
+        if (timer_ != nullptr) {
+            timer_->begin(std::move(name));
+        }
+    }
+
+    ~PhaseScope() {
+        if (timer_ != nullptr) {
+            timer_->end();
+        }
+    }
+
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+};
+
+// Number of calls to the global operator new made by the calling thread since
+// it started. Each thread counts on its own, so counting costs no shared
+// cache line; phases are timed on the thread that runs them.
+unsigned long long allocation_count();
+
+// High-water mark of the resident set size of the process, in KiB.
+long peak_rss_kb();
+
+#endif
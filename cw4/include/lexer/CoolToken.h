@@ -0,0 +1,56 @@
+#ifndef LEXER_COOL_TOKEN_H_
+#define LEXER_COOL_TOKEN_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "CoolLexer.h"
+
+// A token that carries the value the lexer computed for it: the interned
+// string id of a STR_CONST, the value of a BOOL_CONST (0 or 1), or the error
+// code of an ERROR. Other tokens have a value of -1.
+//
+// FastCoolLexer makes these. The generated CoolLexer comes prebuilt and makes
+// plain CommonTokens, whose values are only in its maps keyed by position.
+class CoolToken : public antlr4::CommonToken {
+  public:
+    using antlr4::CommonToken::CommonToken;
+
+    int value = -1;
+};
+
+// Makes CoolTokens. Like the default CommonTokenFactory, it does not copy the
+// text of a token out of the input; `getText` reads it when asked.
+class CoolTokenFactory : public antlr4::TokenFactory<antlr4::CommonToken> {
+  public:
+    std::unique_ptr<antlr4::CommonToken>
+    create(std::pair<antlr4::TokenSource *, antlr4::CharStream *> source,
+           size_t type, const std::string &text, size_t channel, size_t start,
+           size_t stop, size_t line, size_t charPositionInLine) override {
+        auto token =
+            std::make_unique<CoolToken>(source, type, channel, start, stop);
+        token->setLine(line);
+        token->setCharPositionInLine(charPositionInLine);
+        if (!text.empty()) {
+            token->setText(text);
+        }
+        return token;
+    }
+
+    std::unique_ptr<antlr4::CommonToken>
+    create(size_t type, const std::string &text) override {
+        return std::make_unique<CoolToken>(type, text);
+    }
+};
+
+// The value of a BOOL_CONST, STR_CONST or ERROR token. A CoolToken has it at
+// hand; for any other token it is looked up in `lexer`, which must be the
+// lexer that made the token.
+bool get_token_bool_value(CoolLexer &lexer, const antlr4::Token *token);
+const std::string &get_token_csl_text(CoolLexer &lexer,
+                                      const antlr4::Token *token);
+CoolLexer::ErrorCode get_token_error_code(CoolLexer &lexer,
+                                          const antlr4::Token *token);
+
+#endif
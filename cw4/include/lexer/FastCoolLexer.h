@@ -0,0 +1,96 @@
+#ifndef LEXER_FAST_COOL_LEXER_H_
+#define LEXER_FAST_COOL_LEXER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "CoolLexer.h"
+#include "lexer/CoolToken.h"
+
+// A hand-written replacement for the ANTLR-generated CoolLexer. It makes the
+// same tokens as CoolLexer, including positions, error tokens and token
+// values, so it can be put under a CommonTokenStream in its place.
+//
+// The scanner dispatches on a 256-entry table of character classes instead of
+// simulating the ATN. It skips whitespace, comments and plain string text in
+// bulk, and it searches block comments for delimiters 16 bytes at a time.
+//
+// The tokens are CoolTokens, which carry their values. The values also go
+// into the maps and the string table of `lexer`, as CoolLexer would put them
+// there, so `get_csl_text`, `get_bool_value` and `get_error_code` work on
+// these tokens as usual, and `lexer` can be handed to CoolSemantics. The input
+// of `lexer` is never read.
+//
+// `source` is not copied and must outlive the lexer.
+class FastCoolLexer : public antlr4::TokenSource {
+  private:
+    // Position of the scanner in the input. `index` counts code points, like
+    // the index of an ANTLR CharStream.
+    struct Position {
+        const char *cursor;
+        size_t line;
+        size_t column;
+        size_t index;
+    };
+
+    std::string_view source_;
+    std::string source_name_;
+    CoolLexer *lexer_;
+
+    const char *end_;
+    Position position_;
+
+    std::pair<antlr4::TokenSource *, antlr4::CharStream *> token_source_;
+    CoolTokenFactory token_factory_;
+
+    // The contents of the string being scanned.
+    std::string string_buffer_;
+
+    // Moves to `target`, which must not be before the current position.
+    void advance_to(const char *target);
+
+    // Returns the id of `str` in the string table of `lexer_`, adding it if
+    // it is new.
+    int intern_string(const std::string &str);
+
+    std::unique_ptr<CoolToken> make_token(size_t type, const Position &start,
+                                          size_t stop_index,
+                                          std::string_view text,
+                                          int value = -1);
+    std::unique_ptr<CoolToken> make_error(const Position &start,
+                                          const char *stop,
+                                          CoolLexer::ErrorCode code);
+
+    std::unique_ptr<antlr4::Token> lex_identifier();
+    std::unique_ptr<antlr4::Token> lex_integer();
+
+    // These return null when they consumed input without making a token.
+    std::unique_ptr<antlr4::Token> lex_string();
+    std::unique_ptr<antlr4::Token> skip_string_rest(const char *p,
+                                                   CoolLexer::ErrorCode code);
+    std::unique_ptr<antlr4::Token> skip_block_comment();
+
+  public:
+    FastCoolLexer(std::string_view source, std::string source_name,
+                  CoolLexer *lexer);
+
+    FastCoolLexer(const FastCoolLexer &) = delete;
+    FastCoolLexer &operator=(const FastCoolLexer &) = delete;
+
+    std::unique_ptr<antlr4::Token> nextToken() override;
+
+    size_t getLine() const override { return position_.line; }
+    size_t getCharPositionInLine() override { return position_.column; }
+
+    // There is no CharStream behind this lexer; every token has its text set.
+    antlr4::CharStream *getInputStream() override { return nullptr; }
+    std::string getSourceName() override { return source_name_; }
+
+    antlr4::TokenFactory<antlr4::CommonToken> *getTokenFactory() override {
+        return &token_factory_;
+    }
+};
+
+#endif
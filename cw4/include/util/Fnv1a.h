@@ -0,0 +1,37 @@
+#ifndef UTIL_FNV1A_H_
+#define UTIL_FNV1A_H_
+
+#include <cstdint>
+#include <string_view>
+
+// Incremental 64-bit FNV-1a hash. Not cryptographic; it is used to name and
+// key things by their content.
+class Fnv1a {
+  private:
+    uint64_t state_ = 0xcbf29ce484222325ULL;
+
+  public:
+    void add_bytes(std::string_view bytes) {
+        for (unsigned char byte : bytes) {
+            state_ ^= byte;
+            state_ *= 0x100000001b3ULL;
+        }
+    }
+
+    void add_int(int64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            state_ ^= static_cast<uint64_t>(value >> (8 * i)) & 0xff;
+            state_ *= 0x100000001b3ULL;
+        }
+    }
+
+    // Length-prefixed, so that ("ab", "c") and ("a", "bc") hash differently.
+    void add_string(std::string_view text) {
+        add_int(static_cast<int64_t>(text.size()));
+        add_bytes(text);
+    }
+
+    uint64_t get() const { return state_; }
+};
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef UTIL_MAPPED_CHAR_STREAM_H_
+#define UTIL_MAPPED_CHAR_STREAM_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "antlr4-runtime.h"
+
+// A CharStream that reads the input straight from its UTF-8 bytes. Regular
+// files are mapped into memory; anything else, such as a pipe on stdin, is
+// read into a buffer once.
+//
+// ANTLRInputStream decodes the whole input into a UTF-32 string, four bytes
+// per character, before the lexer sees any of it. Here pure ASCII input, by
+// far the common case, needs no extra memory at all: the index of a character
+// is its byte offset, so `LA` is a load and `getText` copies one substring.
+// Other input gets a table with the byte offset of every code point.
+//
+// Behaves exactly like ANTLRInputStream otherwise, including rejecting input
+// that isn't valid UTF-8.
+class MappedCharStream : public antlr4::CharStream {
+  private:
+    std::string source_name_;
+
+    void *mapping_ = nullptr;
+    std::string buffer_;
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+
+    // Byte offset of each code point, followed by `size_`. Empty for ASCII
+    // input.
+    std::vector<uint32_t> offsets_;
+    size_t num_code_points_ = 0;
+
+    size_t position_ = 0;
+
+    void load(int fd) {
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    source_name_);
+        }
+
+        if (S_ISREG(info.st_mode) && info.st_size > 0) {
+            size_ = static_cast<size_t>(info.st_size);
+            mapping_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping_ == MAP_FAILED) {
+                mapping_ = nullptr;
+                throw std::system_error(errno, std::generic_category(),
+                                        source_name_);
+            }
+            madvise(mapping_, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(mapping_);
+        } else if (!S_ISREG(info.st_mode)) {
+            char chunk[64 * 1024];
+            ssize_t count;
+            while ((count = read(fd, chunk, sizeof(chunk))) != 0) {
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(),
+                                            source_name_);
+                }
+                buffer_.append(chunk, static_cast<size_t>(count));
+            }
+            data_ = buffer_.data();
+            size_ = buffer_.size();
+        }
+
+        index_code_points();
+    }
+
+    void index_code_points() {
+        auto bytes = reinterpret_cast<const unsigned char *>(data_);
+
+        bool ascii = std::all_of(bytes, bytes + size_,
+                                 [](unsigned char byte) { return byte < 0x80; });
+        if (ascii) {
+            num_code_points_ = size_;
+            return;
+        }
+
+        if (size_ > UINT32_MAX) {
+            throw antlr4::IllegalArgumentException("input is too large");
+        }
+
+        offsets_.reserve(size_ + 1);
+        for (size_t offset = 0; offset < size_;) {
+            offsets_.push_back(static_cast<uint32_t>(offset));
+
+            size_t length = sequence_length(bytes[offset]);
+            if (length == 0 || offset + length > size_) {
+                throw antlr4::IllegalArgumentException(
+                    "UTF-8 string contains an illegal byte sequence");
+            }
+            for (size_t i = 1; i < length; ++i) {
+                if ((bytes[offset + i] & 0xc0) != 0x80) {
+                    throw antlr4::IllegalArgumentException(
+                        "UTF-8 string contains an illegal byte sequence");
+                }
+            }
+            offset += length;
+        }
+        num_code_points_ = offsets_.size();
+        offsets_.push_back(static_cast<uint32_t>(size_));
+        offsets_.shrink_to_fit();
+    }
+
+    // Length of the UTF-8 sequence starting with `lead`, or 0 if `lead` can't
+    // start one.
+    static size_t sequence_length(unsigned char lead) {
+        if (lead < 0x80) {
+            return 1;
+        }
+        if (lead >= 0xc2 && lead < 0xe0) {
+            return 2;
+        }
+        if (lead >= 0xe0 && lead < 0xf0) {
+            return 3;
+        }
+        if (lead >= 0xf0 && lead < 0xf5) {
+            return 4;
+        }
+        return 0;
+    }
+
+    size_t byte_offset(size_t index) const {
+        return offsets_.empty() ? index : offsets_[index];
+    }
+
+    size_t code_point_at(size_t index) const {
+        if (offsets_.empty()) {
+            return static_cast<unsigned char>(data_[index]);
+        }
+
+        auto bytes = reinterpret_cast<const unsigned char *>(data_);
+        size_t offset = offsets_[index];
+        size_t length = offsets_[index + 1] - offset;
+
+        static constexpr unsigned char LEAD_MASKS[] = {0, 0x7f, 0x1f, 0x0f,
+                                                       0x07};
+        size_t code_point = bytes[offset] & LEAD_MASKS[length];
+        for (size_t i = 1; i < length; ++i) {
+            code_point = (code_point << 6) | (bytes[offset + i] & 0x3f);
+        }
+        return code_point;
+    }
+
+    void init_from_fd(int fd) {
+        try {
+            load(fd);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    void unmap() {
+        if (mapping_ != nullptr) {
+            munmap(mapping_, size_);
+            mapping_ = nullptr;
+        }
+    }
+
+  public:
+    // Reads the file at `path`. Throws std::system_error if it can't be read.
+    explicit MappedCharStream(const std::string &path) : source_name_(path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+
+        try {
+            init_from_fd(fd);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+    }
+
+    // Reads the whole file open on `fd`, which is left open.
+    MappedCharStream(int fd, std::string source_name)
+        : source_name_(std::move(source_name)) {
+        init_from_fd(fd);
+    }
+
+    ~MappedCharStream() override { unmap(); }
+
+    MappedCharStream(const MappedCharStream &) = delete;
+    MappedCharStream &operator=(const MappedCharStream &) = delete;
+
+    // The input as it was read, without decoding.
+    std::string_view get_bytes() const { return {data_, size_}; }
+
+    void consume() override {
+        if (position_ >= num_code_points_) {
+            throw antlr4::IllegalStateException("cannot consume EOF");
+        }
+        ++position_;
+    }
+
+    size_t LA(ssize_t i) override {
+        if (i == 0) {
+            return 0;
+        }
+
+        auto position = static_cast<ssize_t>(position_);
+        if (i < 0) {
+            ++i;
+            if (position + i - 1 < 0) {
+                return antlr4::IntStream::EOF;
+            }
+        }
+        if (position + i - 1 >= static_cast<ssize_t>(num_code_points_)) {
+            return antlr4::IntStream::EOF;
+        }
+        return code_point_at(static_cast<size_t>(position + i - 1));
+    }
+
+    // The whole input is in memory, so there is nothing to mark.
+    ssize_t mark() override { return -1; }
+    void release(ssize_t) override {}
+
+    size_t index() override { return position_; }
+
+    void seek(size_t index) override {
+        position_ = std::min(index, num_code_points_);
+    }
+
+    size_t size() override { return num_code_points_; }
+
+    std::string getSourceName() const override {
+        return source_name_.empty() ? antlr4::IntStream::UNKNOWN_SOURCE_NAME
+                                    : source_name_;
+    }
+
+    std::string getText(const antlr4::misc::Interval &interval) override {
+        if (interval.a < 0 || interval.b < interval.a ||
+            static_cast<size_t>(interval.a) >= num_code_points_) {
+            return "";
+        }
+
+        auto start = static_cast<size_t>(interval.a);
+        auto stop =
+            std::min(static_cast<size_t>(interval.b), num_code_points_ - 1);
+        size_t begin = byte_offset(start);
+        size_t end = byte_offset(stop + 1);
+        return std::string(data_ + begin, end - begin);
+    }
+
+    std::string toString() const override { return {data_, size_}; }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef UTIL_SYMBOL_TABLE_H_
+#define UTIL_SYMBOL_TABLE_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// An identifier or type name interned in a SymbolTable. Two symbols from the
+// same table are equal exactly when their names are, so they can be compared
+// and hashed as integers.
+enum class Symbol : uint32_t {};
+
+// Interns names once so that the rest of the compiler can work with Symbols.
+// Names are never removed, so a Symbol stays valid as long as the table does.
+//
+// A table belongs to one compilation and is not safe to share between
+// threads; files compiled in parallel each have their own.
+class SymbolTable {
+  private:
+    // A deque never moves its elements, so the keys of `symbols_` can point
+    // into it.
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, Symbol> symbols_;
+
+  public:
+    SymbolTable() = default;
+
+    // The keys of `symbols_` point into `names_`, so a copy would point into
+    // the original.
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable &operator=(SymbolTable &&) = default;
+
+    Symbol intern(std::string_view name);
+
+    std::string_view get_name(Symbol symbol) const;
+};
+
+#endif
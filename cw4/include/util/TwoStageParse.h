@@ -0,0 +1,60 @@
+#ifndef UTIL_TWO_STAGE_PARSE_H_
+#define UTIL_TWO_STAGE_PARSE_H_
+
+#include <memory>
+
+#include "antlr4-runtime.h"
+
+// Calls `parse`, which must run the start rule of `parser` exactly once, in
+// two stages. The first uses SLL prediction and BailErrorStrategy, which is
+// much cheaper than full LL and gives up at the first syntax error instead of
+// recovering. That is enough for nearly every input; only when it gives up is
+// `parse` called again with the prediction mode, error strategy and error
+// listeners the parser came with, so syntax errors are reported exactly as
+// before. The listeners are detached during the first stage so that nothing
+// is reported twice.
+//
+// Either way the parser is left with the settings it came with. `fell_back`
+// tells which stage the result came from.
+//
+// The drivers of cw2, cw3template and cw4 all parse through this one copy.
+template <typename Parse>
+auto parse_sll_then_ll(antlr4::Parser &parser, bool &fell_back, Parse parse)
+    -> decltype(parse()) {
+    auto *interpreter =
+        parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+    auto prediction_mode = interpreter->getPredictionMode();
+    auto error_handler = parser.getErrorHandler();
+    auto error_listeners = parser.getErrorListeners();
+
+    auto restore = [&] {
+        interpreter->setPredictionMode(prediction_mode);
+        parser.setErrorHandler(error_handler);
+        parser.removeErrorListeners();
+        for (auto *listener : error_listeners) {
+            parser.addErrorListener(listener);
+        }
+    };
+
+    interpreter->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+    parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+    parser.removeErrorListeners();
+
+    fell_back = false;
+    try {
+        auto result = parse();
+        restore();
+        return result;
+    } catch (const antlr4::ParseCancellationException &) {
+        restore();
+    } catch (...) {
+        restore();
+        throw;
+    }
+
+    fell_back = true;
+    parser.reset();
+    return parse();
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef UTIL_WARMUP_CORPUS_H_
+#define UTIL_WARMUP_CORPUS_H_
+
+#include <span>
+#include <string_view>
+
+// A COOL program compiled into the binary.
+struct WarmupProgram {
+    std::string_view name;
+    std::string_view text;
+};
+
+// The programs that long-running modes parse once before doing any real work,
+// so that the DFA caches of CoolLexer and CoolParser, which all instances in
+// the process share, are already warm for the first real file.
+//
+// Defined in a source file that tools/embed-corpus.cmake generates at build
+// time from the files listed in WARMUP_CORPUS.
+std::span<const WarmupProgram> get_warmup_corpus();
+
+#endif
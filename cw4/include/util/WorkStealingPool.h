@@ -0,0 +1,63 @@
+#ifndef UTIL_WORK_STEALING_POOL_H_
+#define UTIL_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool in which every worker owns a task queue. Tasks are
+// dealt out round-robin; a worker drains its own queue from the back and,
+// once it is empty, steals from the front of the others' queues, so uneven
+// task sizes don't leave cores idle.
+class WorkStealingPool {
+  public:
+    using Task = std::function<void()>;
+
+  private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_queue_{0};
+
+    // Guards the counters below and backs both condition variables.
+    std::mutex state_mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable all_done_;
+    size_t queued_ = 0;
+    size_t unfinished_ = 0;
+    bool stopping_ = false;
+
+    std::optional<Task> take(size_t worker_index);
+    void run_worker(size_t worker_index);
+
+  public:
+    // Zero workers means one per hardware thread.
+    explicit WorkStealingPool(size_t num_workers = 0);
+
+    // Finishes every queued task before joining the workers.
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    size_t get_num_workers() const { return threads_.size(); }
+
+    // Tasks must not throw.
+    void submit(Task task);
+
+    // Blocks until every task submitted so far has finished.
+    void wait();
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "bench/ProgramGenerator.h"
+
+#include <array>
+
+using namespace std;
+
+namespace {
+
+constexpr array<ShapeInfo, 7> SHAPES = {{
+    {ProgramShape::ManyClasses, "many_classes", 2000},
+    {ProgramShape::DeepInheritance, "deep_inheritance", 500},
+    {ProgramShape::LongMethod, "long_method", 10000},
+    {ProgramShape::NestedLet, "nested_let", 400},
+    {ProgramShape::NestedCase, "nested_case", 200},
+    {ProgramShape::WideCase, "wide_case", 1000},
+    {ProgramShape::StringTable, "string_table", 20000},
+}};
+
+string many_classes(size_t size) {
+    string out;
+    for (size_t i = 0; i < size; ++i) {
+        auto name = "C" + to_string(i);
+        out += "class " + name + " inherits IO {\n";
+        out += "    a : Int <- " + to_string(i) + ";\n";
+        out += "    b : String <- \"" + name + "\";\n";
+        out += "    c : Bool <- true;\n";
+        out += "    get() : Int { a + 1 };\n";
+        out += "    twice(x : Int) : Int { x * 2 + get() };\n";
+        out += "    show() : Object { if c then out_string(b) else "
+               "out_int(a) fi };\n";
+        out += "};\n\n";
+    }
+
+    out += "class Main {\n    main() : Object {{\n";
+    for (size_t i = 0; i < size; ++i) {
+        out += "        (new C" + to_string(i) + ").twice(" + to_string(i) +
+               ");\n";
+    }
+    out += "    }};\n};\n";
+    return out;
+}
+
+string deep_inheritance(size_t size) {
+    string out = "class D0 {\n    a0 : Int <- 0;\n    m0() : Int { a0 };\n};\n\n";
+    for (size_t i = 1; i < size; ++i) {
+        auto index = to_string(i);
+        auto parent_index = to_string(i - 1);
+        out += "class D" + index + " inherits D" + parent_index + " {\n";
+        out += "    a" + index + " : Int <- " + index + ";\n";
+        out += "    m" + index + "() : Int { a" + index + " + a" +
+               parent_index + " + a0 + m" + parent_index + "() };\n";
+        out += "};\n\n";
+    }
+
+    auto last = to_string(size - 1);
+    out += "class Main {\n    main() : Object { (new D" + last + ").m" + last +
+           "() };\n};\n";
+    return out;
+}
+
+string long_method(size_t size) {
+    string out = "class Main inherits IO {\n    x : Int;\n    s : String;\n"
+                 "    main() : Object {{\n";
+    for (size_t i = 0; i < size; ++i) {
+        auto value = to_string(i % 1000);
+        switch (i % 4) {
+        case 0:
+            out += "        x <- x + " + value + ";\n";
+            break;
+        case 1:
+            out += "        if x < " + value +
+                   " then x <- x - 1 else x <- x * 2 fi;\n";
+            break;
+        case 2:
+            out += "        while x < 0 loop x <- x + 1 pool;\n";
+            break;
+        case 3:
+            out += "        s <- s.concat(\"v\");\n";
+            break;
+        }
+    }
+    out += "        out_int(x);\n    }};\n};\n";
+    return out;
+}
+
+string nested_let(size_t size) {
+    string out = "class Main inherits IO {\n    main() : Object {\n";
+    for (size_t i = 0; i < size; ++i) {
+        out += "let v" + to_string(i) + " : Int <- " +
+               (i == 0 ? string("0") : "v" + to_string(i - 1) + " + 1") +
+               " in\n";
+    }
+    out += "out_int(v" + to_string(size - 1) + ")\n    };\n};\n";
+    return out;
+}
+
+string nested_case(size_t size) {
+    string out = "class Main inherits IO {\n    main() : Object {\n";
+    for (size_t i = 0; i < size; ++i) {
+        auto index = to_string(i);
+        out += "case " + (i == 0 ? string("self") : "o" + to_string(i - 1)) +
+               " of\n";
+        out += "    i" + index + " : Int => i" + index + ";\n";
+        out += "    s" + index + " : String => s" + index + ".length();\n";
+        out += "    o" + index + " : Object =>\n";
+    }
+    out += "0\n";
+    for (size_t i = 0; i < size; ++i) {
+        out += ";\nesac";
+    }
+    out += "\n    };\n};\n";
+    return out;
+}
+
+string wide_case(size_t size) {
+    string out = "class K0 {\n    tag() : Int { 0 };\n};\n\n";
+    for (size_t i = 1; i < size; ++i) {
+        // Alternate between chains and siblings, so the hierarchy is neither
+        // flat nor a single line.
+        auto parent = i % 2 == 0 ? "K" + to_string(i - 1) : string("K0");
+        out += "class K" + to_string(i) + " inherits " + parent + " {};\n";
+    }
+
+    out += "\nclass Main inherits IO {\n    pick(o : Object) : Int {\n"
+           "        case o of\n";
+    for (size_t i = 0; i < size; ++i) {
+        out += "            k" + to_string(i) + " : K" + to_string(i) + " => " +
+               to_string(i) + ";\n";
+    }
+    out += "            other : Object => 0 - 1;\n        esac\n    };\n";
+    out += "    main() : Object { out_int(pick(new K" + to_string(size / 2) +
+           ")) };\n};\n";
+    return out;
+}
+
+string string_table(size_t size) {
+    string out = "class Main inherits IO {\n    main() : Object {{\n";
+    for (size_t i = 0; i < size; ++i) {
+        out += "        out_string(\"string constant number " + to_string(i) +
+               "\\n\");\n";
+    }
+    out += "    }};\n};\n";
+    return out;
+}
+
+} // namespace
+
+span<const ShapeInfo> all_program_shapes() { return SHAPES; }
+
+optional<ProgramShape> program_shape_from_name(string_view name) {
+    for (const auto &info : SHAPES) {
+        if (info.name == name) {
+            return info.shape;
+        }
+    }
+    return nullopt;
+}
+
+string generate_program(ProgramShape shape, size_t size) {
+    // Every shape needs at least one of the thing it scales.
+    if (size == 0) {
+        size = 1;
+    }
+
+    switch (shape) {
+    case ProgramShape::ManyClasses:
+        return many_classes(size);
+    case ProgramShape::DeepInheritance:
+        return deep_inheritance(size);
+    case ProgramShape::LongMethod:
+        return long_method(size);
+    case ProgramShape::NestedLet:
+        return nested_let(size);
+    case ProgramShape::NestedCase:
+        return nested_case(size);
+    case ProgramShape::WideCase:
+        return wide_case(size);
+    case ProgramShape::StringTable:
+        return string_table(size);
+    }
+    return {};
+}
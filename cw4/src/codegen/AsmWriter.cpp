@@ -0,0 +1,127 @@
+#include "AsmWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <limits.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+AsmWriter::AsmWriter() { start_chunk(); }
+
+AsmWriter::AsmWriter(int fd) : fd_(fd) {
+    chunks_.reserve(CHUNKS_PER_WRITE);
+    start_chunk();
+}
+
+AsmWriter::~AsmWriter() { flush(); }
+
+void AsmWriter::start_chunk() {
+    unique_ptr<char[]> data;
+    if (!spare_chunks_.empty()) {
+        data = std::move(spare_chunks_.back());
+        spare_chunks_.pop_back();
+    } else {
+        data = make_unique_for_overwrite<char[]>(CHUNK_SIZE);
+    }
+
+    cursor_ = data.get();
+    limit_ = cursor_ + CHUNK_SIZE;
+    chunks_.push_back(Chunk{std::move(data), 0});
+}
+
+void AsmWriter::next_chunk() {
+    chunks_.back().size = cursor_ - chunks_.back().data.get();
+
+    if (fd_ >= 0 && chunks_.size() >= CHUNKS_PER_WRITE) {
+        write_chunks();
+    }
+
+    start_chunk();
+}
+
+void AsmWriter::write_slow(string_view text) {
+    while (!text.empty()) {
+        if (cursor_ == limit_) {
+            next_chunk();
+        }
+
+        size_t count = min(text.size(), static_cast<size_t>(limit_ - cursor_));
+        memcpy(cursor_, text.data(), count);
+        cursor_ += count;
+        text.remove_prefix(count);
+    }
+}
+
+// Writes out every finished chunk and recycles their buffers. The caller must
+// have recorded the size of the last chunk.
+void AsmWriter::write_chunks() {
+    vector<iovec> iov;
+    iov.reserve(chunks_.size());
+    for (auto &chunk : chunks_) {
+        if (chunk.size != 0) {
+            iov.push_back(iovec{chunk.data.get(), chunk.size});
+        }
+    }
+
+    size_t next = 0;
+    while (next < iov.size() && !failed_) {
+        int count = static_cast<int>(min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t written = writev(fd_, iov.data() + next, count);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed_ = true;
+            break;
+        }
+
+        // Skip what the kernel took; a short write can stop mid-chunk.
+        auto remaining = static_cast<size_t>(written);
+        while (next < iov.size() && remaining >= iov[next].iov_len) {
+            remaining -= iov[next].iov_len;
+            ++next;
+        }
+        if (remaining != 0) {
+            iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + remaining;
+            iov[next].iov_len -= remaining;
+        }
+    }
+
+    for (auto &chunk : chunks_) {
+        spare_chunks_.push_back(std::move(chunk.data));
+    }
+    chunks_.clear();
+}
+
+void AsmWriter::flush() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    chunks_.back().size = cursor_ - chunks_.back().data.get();
+    write_chunks();
+    start_chunk();
+}
+
+string AsmWriter::take_text() {
+    chunks_.back().size = cursor_ - chunks_.back().data.get();
+
+    size_t total_size = 0;
+    for (const auto &chunk : chunks_) {
+        total_size += chunk.size;
+    }
+
+    string text;
+    text.reserve(total_size);
+    for (auto &chunk : chunks_) {
+        text.append(chunk.data.get(), chunk.size);
+        spare_chunks_.push_back(std::move(chunk.data));
+    }
+    chunks_.clear();
+
+    start_chunk();
+    return text;
+}
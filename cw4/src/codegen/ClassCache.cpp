@@ -0,0 +1,213 @@
+#include "ClassCache.h"
+
+#include "CoolParser.h"
+#include "util/Fnv1a.h"
+
+#include <charconv>
+#include <fstream>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+
+constexpr string_view MAGIC = "COOLCLS2";
+
+void write_u64(ostream &out, uint64_t value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void write_string(ostream &out, const string &text)
+{
+    write_u64(out, text.size());
+    out.write(text.data(), text.size());
+}
+
+bool read_u64(istream &in, uint64_t &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+bool read_string(istream &in, string &text)
+{
+    uint64_t size;
+    if (!read_u64(in, size))
+    {
+        return false;
+    }
+
+    // Guards against a truncated or corrupted size.
+    constexpr uint64_t MAX_SIZE = 1ULL << 32;
+    if (size > MAX_SIZE)
+    {
+        return false;
+    }
+
+    text.resize(size);
+    return static_cast<bool>(in.read(text.data(), size));
+}
+
+} // namespace
+
+ClassCache::ClassCache(filesystem::path directory) : directory_(move(directory))
+{
+    error_code ec;
+    filesystem::create_directories(directory_, ec);
+
+    // Any rebuild of the compiler changes the size or the modification time of
+    // the executable, which is enough to tell builds apart.
+    Fnv1a stamp;
+    auto exe = filesystem::path("/proc/self/exe");
+    stamp.add_int(static_cast<int64_t>(filesystem::file_size(exe, ec)));
+    stamp.add_int(filesystem::last_write_time(exe, ec).time_since_epoch().count());
+    compiler_stamp_ = stamp.get();
+}
+
+filesystem::path ClassCache::path_for(uint64_t key) const
+{
+    char digits[16];
+    auto digits_end = to_chars(digits, digits + 16, key, 16).ptr;
+    return directory_ / (string(digits, digits_end) + ".cls");
+}
+
+optional<ClassCache::Entry> ClassCache::load(uint64_t key)
+{
+    ifstream in(path_for(key), ios::binary);
+
+    char magic[MAGIC.size()];
+    uint64_t stored_key;
+    uint64_t num_strings;
+    uint64_t num_ints;
+    Entry entry;
+
+    bool ok = in.read(magic, MAGIC.size()) && string_view(magic, MAGIC.size()) == MAGIC &&
+              read_u64(in, stored_key) && stored_key == key && read_u64(in, num_strings);
+
+    for (uint64_t i = 0; ok && i < num_strings; ++i)
+    {
+        auto &[str, label] = entry.constants.strings.emplace_back();
+        ok = read_string(in, str) && read_string(in, label);
+    }
+
+    ok = ok && read_u64(in, num_ints);
+    for (uint64_t i = 0; ok && i < num_ints; ++i)
+    {
+        uint64_t value;
+        ok = read_u64(in, value);
+        entry.constants.ints.push_back(static_cast<int>(value));
+    }
+
+    uint64_t bools;
+    ok = ok && read_u64(in, bools) && read_string(in, entry.methods) && read_string(in, entry.init);
+
+    if (!ok)
+    {
+        ++misses_;
+        return nullopt;
+    }
+
+    entry.constants.true_used = bools & 1;
+    entry.constants.false_used = bools & 2;
+
+    ++hits_;
+    return entry;
+}
+
+void ClassCache::store(uint64_t key, const Entry &entry)
+{
+    auto path = path_for(key);
+    auto temp_path = path;
+    temp_path += ".tmp" + to_string(getpid()) + "_" + to_string(next_temp_id_++);
+
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+
+        out.write(MAGIC.data(), MAGIC.size());
+        write_u64(out, key);
+
+        write_u64(out, entry.constants.strings.size());
+        for (const auto &[str, label] : entry.constants.strings)
+        {
+            write_string(out, str);
+            write_string(out, label);
+        }
+
+        write_u64(out, entry.constants.ints.size());
+        for (int value : entry.constants.ints)
+        {
+            write_u64(out, static_cast<uint64_t>(value));
+        }
+
+        write_u64(out, (entry.constants.true_used ? 1 : 0) | (entry.constants.false_used ? 2 : 0));
+        write_string(out, entry.methods);
+        write_string(out, entry.init);
+
+        if (!out)
+        {
+            out.close();
+            error_code ec;
+            filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+
+    // A failed rename only costs a future miss.
+    error_code ec;
+    filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp_path, ec);
+    }
+}
+
+unordered_map<string, uint64_t> ClassCache::hash_class_sources(const vector<antlr4::Token *> &tokens)
+{
+    unordered_map<string, uint64_t> hashes;
+
+    size_t i = 0;
+    while (i < tokens.size())
+    {
+        if (tokens[i]->getType() != CoolParser::CLASS || i + 1 == tokens.size())
+        {
+            ++i;
+            continue;
+        }
+
+        string class_name = tokens[i + 1]->getText();
+
+        Fnv1a hash;
+        int depth = 0;
+        bool in_body = false;
+
+        // Hash up to and including the brace that closes the class body.
+        for (; i < tokens.size(); ++i)
+        {
+            auto *token = tokens[i];
+            size_t type = token->getType();
+            hash.add_int(static_cast<int64_t>(type));
+            hash.add_string(token->getText());
+            if (type == CoolParser::CASE)
+            {
+                hash.add_int(static_cast<int64_t>(token->getLine()));
+            }
+
+            if (type == CoolParser::OCURLY)
+            {
+                ++depth;
+                in_body = true;
+            }
+            else if (type == CoolParser::CCURLY && --depth == 0 && in_body)
+            {
+                ++i;
+                break;
+            }
+        }
+
+        hashes[class_name] = hash.get();
+    }
+
+    return hashes;
+}
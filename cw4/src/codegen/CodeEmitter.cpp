@@ -8,32 +8,30 @@ using namespace std;
 
 namespace riscv_emit { 
 
-int if_then_else_fi_label_count = 0;
-int while_loop_pool_label_count = 0;
-int case_of_esac_count = 0;
-
-void emit_comment(ostream &out, string_view comment) {
-    out << "# " << comment << endl;
+void emit_comment(AsmWriter &out, string_view comment) {
+    out << "# " << comment << '\n';
 }
 
-void emit_ident(ostream &out) { out << "    "; }
+void emit_ident(AsmWriter &out) { out << "    "; }
 
-void emit_header_comment(ostream &out, string comment) {
-    string half_line((76 - comment.length()) / 2, '-');
-    string rounding = comment.length() % 2 == 1 ? "-" : "";
-    emit_comment(out, half_line + " " + comment + " " + half_line + rounding);
+void emit_header_comment(AsmWriter &out, string_view comment) {
+    constexpr string_view dashes = "--------------------------------------";
+    string_view half_line = dashes.substr(0, (76 - comment.length()) / 2);
+    string_view rounding = comment.length() % 2 == 1 ? "-" : "";
+    out << "# " << half_line << " " << comment << " " << half_line << rounding
+        << '\n';
 }
 
-void emit_directive(ostream &out, string name) { out << "." << name; }
+void emit_directive(AsmWriter &out, string_view name) { out << "." << name; }
 
-void emit_p2align(ostream &out, int value) {
+void emit_p2align(AsmWriter &out, int value) {
     emit_ident(out);
     emit_directive(out, "p2align");
-    out << " " << value << endl;
+    out << " " << value << '\n';
 }
 
 // Emits a word that is a specific value; also optionally emits a comment.
-void emit_word(ostream &out, int value, string inline_comment) {
+void emit_word(AsmWriter &out, int value, string_view inline_comment) {
     emit_ident(out);
     emit_directive(out, "word");
     out << " " << value;
@@ -41,12 +39,13 @@ void emit_word(ostream &out, int value, string inline_comment) {
         out << "  ";
         emit_comment(out, inline_comment);
     } else {
-        out << endl;
+        out << '\n';
     }
 }
 
 // Emits a string that is a specific value; also optionally emits a comment.
-void emit_string(ostream &out, string value, string inline_comment) {
+void emit_string(AsmWriter &out, string_view value,
+                 string_view inline_comment) {
     emit_ident(out);
     emit_directive(out, "string");
     out << " " << value;
@@ -54,12 +53,12 @@ void emit_string(ostream &out, string value, string inline_comment) {
         out << "  ";
         emit_comment(out, inline_comment);
     } else {
-        out << endl;
+        out << '\n';
     }
 }
 
 // Emits a byte that is a specific value; also optionally emits a comment.
-void emit_byte(ostream &out, int value, string inline_comment) {
+void emit_byte(AsmWriter &out, int value, string_view inline_comment) {
     emit_ident(out);
     emit_directive(out, "byte");
     out << " " << value;
@@ -67,18 +66,18 @@ void emit_byte(ostream &out, int value, string inline_comment) {
         out << "  ";
         emit_comment(out, inline_comment);
     } else {
-        out << endl;
+        out << '\n';
     }
 }
 
 // Emits a word that is the address of a symbol.
-void emit_word(ostream &out, string symbol) {
+void emit_word(AsmWriter &out, string_view symbol) {
     emit_ident(out);
     emit_directive(out, "word");
-    out << " " << symbol << endl;
+    out << " " << symbol << '\n';
 }
 
-void emit_add(ostream &out, Register dest, Register lhs, Register rhs) {
+void emit_add(AsmWriter &out, Register dest, Register lhs, Register rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Add);
     out << " ";
@@ -87,20 +86,20 @@ void emit_add(ostream &out, Register dest, Register lhs, Register rhs) {
     emit_register(out, lhs);
     out << ", ";
     emit_register(out, rhs);
-    out << endl;
+    out << '\n';
 }
 
-void emit_add_immediate(ostream &out, Register dest, Register lhs, int rhs) {
+void emit_add_immediate(AsmWriter &out, Register dest, Register lhs, int rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::AddImmediate);
     out << " ";
     emit_register(out, dest);
     out << ", ";
     emit_register(out, lhs);
-    out << ", " << rhs << endl;
+    out << ", " << rhs << '\n';
 }
 
-void emit_subtract(ostream &out, Register dest, Register lhs, Register rhs) {
+void emit_subtract(AsmWriter &out, Register dest, Register lhs, Register rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Subtract);
     out << " ";
@@ -109,10 +108,10 @@ void emit_subtract(ostream &out, Register dest, Register lhs, Register rhs) {
     emit_register(out, lhs);
     out << ", ";
     emit_register(out, rhs);
-    out << endl;
+    out << '\n';
 }
 
-void emit_multiply(ostream &out, Register dest, Register lhs, Register rhs) {
+void emit_multiply(AsmWriter &out, Register dest, Register lhs, Register rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Multiply);
     out << " ";
@@ -121,10 +120,10 @@ void emit_multiply(ostream &out, Register dest, Register lhs, Register rhs) {
     emit_register(out, lhs);
     out << ", ";
     emit_register(out, rhs);
-    out << endl;
+    out << '\n';
 }
 
-void emit_divide(ostream &out, Register dest, Register lhs, Register rhs) {
+void emit_divide(AsmWriter &out, Register dest, Register lhs, Register rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Divide);
     out << " ";
@@ -133,20 +132,20 @@ void emit_divide(ostream &out, Register dest, Register lhs, Register rhs) {
     emit_register(out, lhs);
     out << ", ";
     emit_register(out, rhs);
-    out << endl;
+    out << '\n';
 }
 
-void emit_xor_immediate(ostream &out, Register dest, Register lhs, int rhs) {
+void emit_xor_immediate(AsmWriter &out, Register dest, Register lhs, int rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::XorImmediate);
     out << " ";
     emit_register(out, dest);
     out << ", ";
     emit_register(out, lhs);
-    out << ", " << rhs << endl;
+    out << ", " << rhs << '\n';
 }
 
-void emit_shift_left_immediate(ostream &out, Register dest, Register src,
+void emit_shift_left_immediate(AsmWriter &out, Register dest, Register src,
                                int immediate) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::ShiftLeftLogicalImmediate);
@@ -156,20 +155,20 @@ void emit_shift_left_immediate(ostream &out, Register dest, Register src,
     emit_register(out, src);
     out << ", ";
     out << immediate;
-    out << endl;
+    out << '\n';
 }
 
-void emit_set_equal_zero(ostream &out, Register dest, Register src) {
+void emit_set_equal_zero(AsmWriter &out, Register dest, Register src) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::SetEqualZero);
     out << " ";
     emit_register(out, dest);
     out << ", ";
     emit_register(out, src);
-    out << endl;
+    out << '\n';
 }
 
-void emit_set_less_than(ostream &out, Register dest, Register lhs,
+void emit_set_less_than(AsmWriter &out, Register dest, Register lhs,
                         Register rhs) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::SetLessThan);
@@ -179,32 +178,32 @@ void emit_set_less_than(ostream &out, Register dest, Register lhs,
     emit_register(out, lhs);
     out << ", ";
     emit_register(out, rhs);
-    out << endl;
+    out << '\n';
 }
 
-void emit_label(ostream &out, string label) { out << label << ":" << endl; }
+void emit_label(AsmWriter &out, string_view label) { out << label << ":\n"; }
 
-void emit_globl(ostream &out, string label) {
+void emit_globl(AsmWriter &out, string_view label) {
     emit_directive(out, "globl");
-    out << " " << label << endl;
+    out << " " << label << '\n';
 }
 
 // In reality: just "emit new line", but useful for readability of code using
 // this library. Not so useful inside the library, so resist temptation to reuse
-// in all places that use "out << endl" in this file.
-void emit_empty_line(ostream &out) { out << endl; }
+// in all places that use "out << '\n'" in this file.
+void emit_empty_line(AsmWriter &out) { out << '\n'; }
 
-void emit_text_segment_tag(ostream &out) {
+void emit_text_segment_tag(AsmWriter &out) {
     emit_directive(out, "text");
-    out << endl;
+    out << '\n';
 }
 
-void emit_data_segment_tag(ostream &out) {
+void emit_data_segment_tag(AsmWriter &out) {
     emit_directive(out, "data");
-    out << endl;
+    out << '\n';
 }
 
-void emit_mnemonic(ostream &out, Mnemonic mnemonic) {
+void emit_mnemonic(AsmWriter &out, Mnemonic mnemonic) {
     switch (mnemonic) {
     case Mnemonic::Add:
         out << "add";
@@ -280,7 +279,7 @@ template <typename> constexpr bool always_false = false;
 
 #include <typeinfo>
 
-void emit_register(ostream &out, Register reg) {
+void emit_register(AsmWriter &out, Register reg) {
     std::visit(
         overload{[&out](ZeroRegister zero) { out << "zero"; },
                  [&out](ReturnAddress ra) { out << "ra"; },
@@ -296,7 +295,7 @@ void emit_register(ostream &out, Register reg) {
         reg);
 }
 
-void emit_memory_location(ostream &out, MemoryLocation location) {
+void emit_memory_location(AsmWriter &out, MemoryLocation location) {
     out << location.offset_in_bytes << "(";
     emit_register(out, location.base);
     out << ")";
@@ -306,7 +305,7 @@ void emit_memory_location(ostream &out, MemoryLocation location) {
 // register. Uses the concrete instsruction/mnemonic `add`.
 //
 // Example gen: [    add fp, sp, 0\n]
-void emit_move(ostream &out, Register dest, Register src) {
+void emit_move(AsmWriter &out, Register dest, Register src) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Add);
     out << " ";
@@ -315,7 +314,7 @@ void emit_move(ostream &out, Register dest, Register src) {
     emit_register(out, src);
     out << ", ";
     emit_register(out, ZeroRegister{});
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "store word" instruction that stores the value of the `src` register
@@ -324,14 +323,14 @@ void emit_move(ostream &out, Register dest, Register src) {
 // `sw`.
 //
 // Example gen: [    sw ra, 0(sp)\n]
-void emit_store_word(ostream &out, Register src, MemoryLocation dest) {
+void emit_store_word(AsmWriter &out, Register src, MemoryLocation dest) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::StoreWord);
     out << " ";
     emit_register(out, src);
     out << ", ";
     emit_memory_location(out, dest);
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "load word" instruction that loads into the `dest` register the
@@ -339,14 +338,14 @@ void emit_store_word(ostream &out, Register src, MemoryLocation dest) {
 // number of bytes. Uses the concrete instsruction/mnemonic `lw`.
 //
 // Example gen: [    lw ra, 0(fp)\n]
-void emit_load_word(ostream &out, Register dest, MemoryLocation src) {
+void emit_load_word(AsmWriter &out, Register dest, MemoryLocation src) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::LoadWord);
     out << " ";
     emit_register(out, dest);
     out << ", ";
     emit_memory_location(out, src);
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "load address" instruction that loads into the `dest` register the
@@ -354,22 +353,22 @@ void emit_load_word(ostream &out, Register dest, MemoryLocation src) {
 // `la`.
 //
 // Example gen: [    la t0, _string1.content\n]
-void emit_load_address(ostream &out, Register dest, string label) {
+void emit_load_address(AsmWriter &out, Register dest, string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::LoadAddress);
     out << " ";
     emit_register(out, dest);
     out << ", ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
-void emit_jump(ostream &out, string label) {
+void emit_jump(AsmWriter &out, string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Jump);
     out << " ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "jump and link" instruction that transfers control to the code at
@@ -377,12 +376,12 @@ void emit_jump(ostream &out, string label) {
 // Uses the concrete instsruction/mnemonic `jal`.
 //
 // Example gen: [    jal IO.out_string\n]
-void emit_jump_and_link(ostream &out, string function_label) {
+void emit_jump_and_link(AsmWriter &out, string_view function_label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::JumpAndLink);
     out << " ";
     out << function_label;
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "call" instruction that transfers control to the code at
@@ -390,12 +389,12 @@ void emit_jump_and_link(ostream &out, string function_label) {
 // Uses the concrete instsruction/mnemonic `call`.
 //
 // Example gen: [    call IO.out_string\n]
-void emit_call(ostream &out, string function_label) {
+void emit_call(AsmWriter &out, string_view function_label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::Call);
     out << " ";
     out << function_label;
-    out << endl;
+    out << '\n';
 }
 
 // Emits a "jump and link register" instruction that transfers control to the
@@ -404,7 +403,7 @@ void emit_call(ostream &out, string function_label) {
 // Uses the concrete instsruction/mnemonic `jalr`.
 //
 // Example gen: [    jalr t0\n]
-void emit_jump_and_link_register(ostream &out, Register reg) {
+void emit_jump_and_link_register(AsmWriter &out, Register reg) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::JumpAndLinkRegister);
     out << " ";
@@ -412,7 +411,7 @@ void emit_jump_and_link_register(ostream &out, Register reg) {
     out << "(";
     emit_register(out, reg);
     out << ")";
-    out << endl;
+    out << '\n';
 
     // offset; not much use to jumping to an offset label...; this lead me to a
     // 15 min debug, so perhaps worth expanding: one might mistake the
@@ -430,44 +429,48 @@ void emit_jump_and_link_register(ostream &out, Register reg) {
     // there. Huge difference.
 }
 
-void emit_branch_equal_zero(ostream &out, Register reg, string label) {
+void emit_branch_equal_zero(AsmWriter &out, Register reg,
+                            string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::BranchEqualZero);
     out << " ";
     emit_register(out, reg);
     out << ", ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
-void emit_branch_not_equal_zero(ostream &out, Register reg, string label) {
+void emit_branch_not_equal_zero(AsmWriter &out, Register reg,
+                                string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::BranchNotEqualZero);
     out << " ";
     emit_register(out, reg);
     out << ", ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
-void emit_branch_less_than_zero(ostream &out, Register reg, string label) {
+void emit_branch_less_than_zero(AsmWriter &out, Register reg,
+                                string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::BranchLessThanZero);
     out << " ";
     emit_register(out, reg);
     out << ", ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
-void emit_branch_greater_than_zero(ostream &out, Register reg, string label) {
+void emit_branch_greater_than_zero(AsmWriter &out, Register reg,
+                                   string_view label) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::BranchGreaterThanZero);
     out << " ";
     emit_register(out, reg);
     out << ", ";
     out << label;
-    out << endl;
+    out << '\n';
 }
 
 // Emits an instruction that adjusts the stack pointer according to the given
@@ -475,7 +478,7 @@ void emit_branch_greater_than_zero(ostream &out, Register reg, string label) {
 // negative addresses, so `num_of_words` is multiplied by -4.
 //
 // Example gen: [    addi sp, sp, -4\n]
-void emit_grow_stack(ostream &out, int num_of_words) {
+void emit_grow_stack(AsmWriter &out, int num_of_words) {
     emit_ident(out);
     emit_mnemonic(out, Mnemonic::AddImmediate);
     out << " ";
@@ -484,15 +487,15 @@ void emit_grow_stack(ostream &out, int num_of_words) {
     emit_register(out, StackPointer{});
     out << ", ";
     out << (-4) * num_of_words;
-    out << endl;
+    out << '\n';
 }
 
-void emit_push_register(ostream &out, Register reg) {
+void emit_push_register(AsmWriter &out, Register reg) {
     emit_store_word(out, reg, MemoryLocation{0, StackPointer{}});
     emit_grow_stack(out, /*num_of_words=*/1);
 }
 
-void emit_pop_into_register(ostream &out, Register reg) {
+void emit_pop_into_register(AsmWriter &out, Register reg) {
     emit_grow_stack(out, /*num_of_words=*/-1);
     emit_load_word(out, reg, MemoryLocation{0, StackPointer{}});
 }
@@ -500,7 +503,7 @@ void emit_pop_into_register(ostream &out, Register reg) {
 // Emits a series of instructions that move data from one location to another.
 // Supports reg to reg, mem to reg, and reg to mem. TODO: mem to mem is not
 // supported.
-void emit_move_data_between_locations(std::ostream &out, Location src,
+void emit_move_data_between_locations(AsmWriter &out, Location src,
                                       Location dest) {
     if (src == dest) {
         return;
@@ -532,6 +535,6 @@ void emit_move_data_between_locations(std::ostream &out, Location src,
 
 constexpr int GC_TAG = -1;
 
-void emit_gc_tag(ostream &out) { emit_word(out, GC_TAG, "GC tag"); }
+void emit_gc_tag(AsmWriter &out) { emit_word(out, GC_TAG, "GC tag"); }
 
 } // namespace riscv_emit
@@ -2,28 +2,48 @@
 
 #include "codegen/CodeEmitter.h"
 #include "codegen/Register.h"
+#include "util/Fnv1a.h"
 #include <cmath>
 
 using namespace std;
 
-void CoolCodegen::generate(ostream &out)
+void CoolCodegen::generate(AsmWriter &out, PhaseTimer *timer)
 {
-    class_table_->normalize_indexes();
-    class_table_->compute_sub_hierarchy_sizes();
+    {
+        PhaseScope phase(timer, "class_table");
+        class_table_->normalize_indexes();
+        class_table_->compute_sub_hierarchy_sizes();
+
+        if (class_cache_ != nullptr)
+        {
+            layout_hash_ = compute_layout_hash();
+        }
+    }
+
+    {
+        PhaseScope phase(timer, "emit_methods");
+        emit_methods(out);
+    }
+
+    {
+        PhaseScope phase(timer, "emit_tables");
+        emit_tables(out);
+    }
 
-    emit_methods(out);
-    emit_tables(out);
-    static_constants_.emit_all(out);
+    {
+        PhaseScope phase(timer, "emit_constants");
+        static_constants_.emit_all(out);
+    }
 }
 
-void CoolCodegen::emit_methods(ostream &out)
+void CoolCodegen::emit_methods(AsmWriter &out)
 {
     riscv_emit::emit_directive(out, "text");
     riscv_emit::emit_empty_line(out);
 
     // Used by runtime for errors
     riscv_emit::emit_label(out, "_inf_loop");
-    out << "    j _inf_loop" << endl;
+    out << "    j _inf_loop\n";
     riscv_emit::emit_empty_line(out);
 
     riscv_emit::emit_header_comment(out, "Method Implementations");
@@ -42,61 +62,88 @@ void CoolCodegen::emit_methods(ostream &out)
             continue;
         }
 
-        auto methods = class_table_->get_method_names(class_index);
+        CachedClass *cached = look_up_cached_class(class_index, class_name);
+        if (cached == nullptr)
+        {
+            emit_class_methods(out, class_index, class_name);
+        }
+        else
+        {
+            if (!cached->hit)
+            {
+                static_constants_.start_recording(&cached->entry.constants);
+                emit_class_methods(scratch_, class_index, class_name);
+                static_constants_.stop_recording();
+                cached->entry.methods = scratch_.take_text();
+            }
+
+            out << cached->entry.methods;
+        }
 
-        for (const auto &method_name : methods)
+        if (release_bodies_)
         {
-            riscv_emit::emit_empty_line(out);
-            riscv_emit::emit_directive(out, "globl");
-            string function_label = class_name + "." + method_name;
-            out << " " << function_label << endl;
-            riscv_emit::emit_label(out, function_label);
+            release_method_bodies(class_index);
+        }
+    }
 
-            // Prologue
-            riscv_emit::emit_add(out, FramePointer{}, StackPointer{}, ZeroRegister{});
+    riscv_emit::emit_empty_line(out);
+}
 
-            riscv_emit::emit_store_word(out, ReturnAddress{}, MemoryLocation{0, StackPointer{}});
-            riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
+void CoolCodegen::emit_class_methods(AsmWriter &out, int class_index, const string &class_name)
+{
+    auto methods = class_table_->get_method_names(class_index);
 
-            riscv_emit::emit_store_word(out, SavedRegister{1}, MemoryLocation{0, StackPointer{}});
-            riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
+    for (const auto &method_name : methods)
+    {
+        riscv_emit::emit_empty_line(out);
+        riscv_emit::emit_directive(out, "globl");
+        string function_label = class_name + "." + method_name;
+        out << " " << function_label << '\n';
+        riscv_emit::emit_label(out, function_label);
+        context_.begin_routine(function_label);
 
-            // s1 = self
-            riscv_emit::emit_add(out, SavedRegister{1}, ArgumentRegister{0}, ZeroRegister{});
-            riscv_emit::emit_empty_line(out);
+        // Prologue
+        riscv_emit::emit_add(out, FramePointer{}, StackPointer{}, ZeroRegister{});
 
-            // Method body
-            expression_codegen_.reset_frame();
-            expression_codegen_.set_current_class(class_index);
-            expression_codegen_.begin_scope();
-            auto formals = class_table_->get_argument_names(class_index, method_name);
-            expression_codegen_.bind_formals(formals);
+        riscv_emit::emit_store_word(out, ReturnAddress{}, MemoryLocation{0, StackPointer{}});
+        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
 
-            expression_codegen_.generate(out, class_table_->get_method_body(class_index, method_name));
+        riscv_emit::emit_store_word(out, SavedRegister{1}, MemoryLocation{0, StackPointer{}});
+        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
 
-            expression_codegen_.end_scope();
+        // s1 = self
+        riscv_emit::emit_add(out, SavedRegister{1}, ArgumentRegister{0}, ZeroRegister{});
+        riscv_emit::emit_empty_line(out);
 
-            // Epilogue
-            riscv_emit::emit_load_word(out, SavedRegister{1}, MemoryLocation{-4, FramePointer{}});
-            riscv_emit::emit_load_word(out, ReturnAddress{}, MemoryLocation{0, FramePointer{}});
+        // Method body
+        expression_codegen_.reset_frame();
+        expression_codegen_.set_current_class(class_index);
+        expression_codegen_.begin_scope();
+        auto formals = class_table_->get_argument_names(class_index, method_name);
+        expression_codegen_.bind_formals(formals);
 
-            // Pop control link & args
-            int saved_regs = 1;
-            int argc = (int)formals.size();
-            int pop_bytes = 4 * (argc + saved_regs + 2);
-            riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, pop_bytes);
+        expression_codegen_.generate(out, class_table_->get_method_body(class_index, method_name));
 
-            riscv_emit::emit_load_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
+        expression_codegen_.end_scope();
 
-            riscv_emit::emit_mnemonic(out, Mnemonic::Return);
-            riscv_emit::emit_empty_line(out);
-        }
-    }
+        // Epilogue
+        riscv_emit::emit_load_word(out, SavedRegister{1}, MemoryLocation{-4, FramePointer{}});
+        riscv_emit::emit_load_word(out, ReturnAddress{}, MemoryLocation{0, FramePointer{}});
 
-    riscv_emit::emit_empty_line(out);
+        // Pop control link & args
+        int saved_regs = 1;
+        int argc = (int)formals.size();
+        int pop_bytes = 4 * (argc + saved_regs + 2);
+        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, pop_bytes);
+
+        riscv_emit::emit_load_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
+
+        riscv_emit::emit_mnemonic(out, Mnemonic::Return);
+        riscv_emit::emit_empty_line(out);
+    }
 }
 
-void CoolCodegen::emit_tables(ostream &out)
+void CoolCodegen::emit_tables(AsmWriter &out)
 {
     riscv_emit::emit_directive(out, "data");
     riscv_emit::emit_empty_line(out);
@@ -112,12 +159,12 @@ void CoolCodegen::emit_tables(ostream &out)
     emit_class_object_table(out, class_names);
 }
 
-void CoolCodegen::emit_name_table(ostream &out, vector<string> &class_names)
+void CoolCodegen::emit_name_table(AsmWriter &out, vector<string> &class_names)
 {
     riscv_emit::emit_header_comment(out, "Class Name Table");
     riscv_emit::emit_p2align(out, 2);
     riscv_emit::emit_directive(out, "globl");
-    out << " class_nameTab" << endl;
+    out << " class_nameTab\n";
     riscv_emit::emit_label(out, "class_nameTab");
 
     for (const auto &class_name : class_names)
@@ -133,13 +180,13 @@ void CoolCodegen::emit_name_table(ostream &out, vector<string> &class_names)
     }
 }
 
-void CoolCodegen::emit_className_attributes(ostream &out, const string &class_name)
+void CoolCodegen::emit_className_attributes(AsmWriter &out, const string &class_name)
 {
     emit_length_attribute(out, class_name);
     emit_className(out, class_name);
 }
 
-void CoolCodegen::emit_length_attribute(ostream &out, const string &class_name)
+void CoolCodegen::emit_length_attribute(AsmWriter &out, const string &class_name)
 {
     riscv_emit::emit_gc_tag(out);
     riscv_emit::emit_label(out, class_name + "_classNameLength");
@@ -150,7 +197,7 @@ void CoolCodegen::emit_length_attribute(ostream &out, const string &class_name)
     riscv_emit::emit_empty_line(out);
 }
 
-void CoolCodegen::emit_className(ostream &out, const string &class_name)
+void CoolCodegen::emit_className(AsmWriter &out, const string &class_name)
 {
     riscv_emit::emit_gc_tag(out);
     riscv_emit::emit_label(out, class_name + "_className");
@@ -171,7 +218,7 @@ void CoolCodegen::emit_className(ostream &out, const string &class_name)
     riscv_emit::emit_empty_line(out);
 }
 
-void CoolCodegen::emit_prototype_tables(ostream &out, vector<string> &class_names)
+void CoolCodegen::emit_prototype_tables(AsmWriter &out, vector<string> &class_names)
 {
     riscv_emit::emit_header_comment(out, "Prototype Object Table");
     riscv_emit::emit_p2align(out, 2);
@@ -182,11 +229,11 @@ void CoolCodegen::emit_prototype_tables(ostream &out, vector<string> &class_name
     }
 }
 
-void CoolCodegen::emit_prototype_table(ostream &out, const string &class_name)
+void CoolCodegen::emit_prototype_table(AsmWriter &out, const string &class_name)
 {
     riscv_emit::emit_gc_tag(out);
     riscv_emit::emit_directive(out, "globl");
-    out << " " << class_name << "_protObj" << endl;
+    out << " " << class_name << "_protObj\n";
     riscv_emit::emit_label(out, class_name + "_protObj");
     riscv_emit::emit_word(out, class_table_->get_index(class_name)); // tag
 
@@ -262,7 +309,7 @@ void CoolCodegen::emit_prototype_table(ostream &out, const string &class_name)
     riscv_emit::emit_empty_line(out);
 }
 
-void CoolCodegen::emit_dispatch_tables(ostream &out, vector<string> &class_names, vector<string> &base_class_names)
+void CoolCodegen::emit_dispatch_tables(AsmWriter &out, vector<string> &class_names, vector<string> &base_class_names)
 {
     riscv_emit::emit_header_comment(out, "Dispatch Tables");
     for (const auto &class_name : class_names)
@@ -271,12 +318,12 @@ void CoolCodegen::emit_dispatch_tables(ostream &out, vector<string> &class_names
     }
 }
 
-void CoolCodegen::emit_dispatch_table(ostream &out, const string &class_name, vector<string> &base_class_names)
+void CoolCodegen::emit_dispatch_table(AsmWriter &out, const string &class_name, vector<string> &base_class_names)
 {
     if (find(base_class_names.begin(), base_class_names.end(), class_name) != base_class_names.end())
     {
         riscv_emit::emit_directive(out, "globl");
-        out << " " << class_name << "_dispTab" << endl;
+        out << " " << class_name << "_dispTab\n";
     }
 
     riscv_emit::emit_label(out, class_name + "_dispTab");
@@ -293,7 +340,7 @@ void CoolCodegen::emit_dispatch_table(ostream &out, const string &class_name, ve
     riscv_emit::emit_empty_line(out);
 }
 
-void CoolCodegen::emit_initialization_methods(ostream &out, vector<string> &class_names)
+void CoolCodegen::emit_initialization_methods(AsmWriter &out, vector<string> &class_names)
 {
     riscv_emit::emit_header_comment(out, "Initialization Methods");
 
@@ -431,56 +478,88 @@ String_init:\n\
         if (find(base.begin(), base.end(), cls) != base.end())
             continue;
 
-        riscv_emit::emit_globl(out, cls + "_init");
-        riscv_emit::emit_label(out, cls + "_init");
+        int class_index = class_table_->get_index(cls);
 
-        // Prologue
-        riscv_emit::emit_add(out, FramePointer{}, StackPointer{}, ZeroRegister{});
-        riscv_emit::emit_store_word(out, ReturnAddress{}, MemoryLocation{0, StackPointer{}});
-        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
+        auto cached = cached_classes_.find(class_index);
+        if (cached == cached_classes_.end())
+        {
+            emit_initialization_method(out, class_index, cls);
+        }
+        else
+        {
+            auto &[key, hit, entry] = cached->second;
+            if (!hit)
+            {
+                static_constants_.start_recording(&entry.constants);
+                emit_initialization_method(scratch_, class_index, cls);
+                static_constants_.stop_recording();
+                entry.init = scratch_.take_text();
 
-        riscv_emit::emit_store_word(out, SavedRegister{1}, MemoryLocation{0, StackPointer{}});
-        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
+                class_cache_->store(key, entry);
+            }
 
-        riscv_emit::emit_add(out, SavedRegister{1}, ArgumentRegister{0}, ZeroRegister{});
-        riscv_emit::emit_empty_line(out);
+            out << entry.init;
+            cached_classes_.erase(cached);
+        }
 
-        // Parents init
-        int class_index = class_table_->get_index(cls);
-        string parent(class_table_->get_name(class_table_->get_parent_index(class_index)));
+        if (release_bodies_)
+        {
+            release_attribute_initializers(class_index, cls);
+        }
+    }
 
-        riscv_emit::emit_store_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
-        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
-        riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
-        riscv_emit::emit_call(out, parent + "_init");
-        riscv_emit::emit_empty_line(out);
+    riscv_emit::emit_empty_line(out);
+}
 
-        // Initialize our own attributes
-        riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
+void CoolCodegen::emit_initialization_method(AsmWriter &out, int class_index, const string &cls)
+{
+    riscv_emit::emit_globl(out, cls + "_init");
+    riscv_emit::emit_label(out, cls + "_init");
+    context_.begin_routine(cls + "_init");
 
-        expression_codegen_.reset_frame();
-        expression_codegen_.set_current_class(class_index);
-        expression_codegen_.begin_scope();
-        expression_codegen_.emit_attributes(out, class_table_->get_attributes(class_index), class_index);
-        expression_codegen_.end_scope();
-        riscv_emit::emit_empty_line(out);
+    // Prologue
+    riscv_emit::emit_add(out, FramePointer{}, StackPointer{}, ZeroRegister{});
+    riscv_emit::emit_store_word(out, ReturnAddress{}, MemoryLocation{0, StackPointer{}});
+    riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
 
-        // return self
-        riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
+    riscv_emit::emit_store_word(out, SavedRegister{1}, MemoryLocation{0, StackPointer{}});
+    riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
 
-        // Epilogue
-        riscv_emit::emit_load_word(out, SavedRegister{1}, MemoryLocation{-4, FramePointer{}});
-        riscv_emit::emit_load_word(out, ReturnAddress{}, MemoryLocation{0, FramePointer{}});
-        riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, 12);
-        riscv_emit::emit_load_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
-        riscv_emit::emit_mnemonic(out, Mnemonic::Return);
-        riscv_emit::emit_empty_line(out);
-    }
+    riscv_emit::emit_add(out, SavedRegister{1}, ArgumentRegister{0}, ZeroRegister{});
+    riscv_emit::emit_empty_line(out);
+
+    // Parents init
+    string parent(class_table_->get_name(class_table_->get_parent_index(class_index)));
+
+    riscv_emit::emit_store_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
+    riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
+    riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
+    riscv_emit::emit_call(out, parent + "_init");
+    riscv_emit::emit_empty_line(out);
+
+    // Initialize our own attributes
+    riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
 
+    expression_codegen_.reset_frame();
+    expression_codegen_.set_current_class(class_index);
+    expression_codegen_.begin_scope();
+    expression_codegen_.emit_attributes(out, class_table_->get_attributes(class_index), class_index);
+    expression_codegen_.end_scope();
+    riscv_emit::emit_empty_line(out);
+
+    // return self
+    riscv_emit::emit_add(out, ArgumentRegister{0}, SavedRegister{1}, ZeroRegister{});
+
+    // Epilogue
+    riscv_emit::emit_load_word(out, SavedRegister{1}, MemoryLocation{-4, FramePointer{}});
+    riscv_emit::emit_load_word(out, ReturnAddress{}, MemoryLocation{0, FramePointer{}});
+    riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, 12);
+    riscv_emit::emit_load_word(out, FramePointer{}, MemoryLocation{0, StackPointer{}});
+    riscv_emit::emit_mnemonic(out, Mnemonic::Return);
     riscv_emit::emit_empty_line(out);
 }
 
-void CoolCodegen::emit_class_object_table(ostream &out, vector<string> &class_names)
+void CoolCodegen::emit_class_object_table(AsmWriter &out, vector<string> &class_names)
 {
     riscv_emit::emit_header_comment(out, "Class Object Table");
     riscv_emit::emit_label(out, "class_objTab");
@@ -493,3 +572,104 @@ void CoolCodegen::emit_class_object_table(ostream &out, vector<string> &class_na
 
     riscv_emit::emit_empty_line(out);
 }
+
+void CoolCodegen::use_class_cache(ClassCache *class_cache, unordered_map<string, uint64_t> class_source_hashes)
+{
+    class_cache_ = class_cache;
+    class_source_hashes_ = move(class_source_hashes);
+    static_constants_.use_content_labels();
+}
+
+uint64_t CoolCodegen::compute_layout_hash()
+{
+    // The code of a class refers to the tags, attribute offsets and method
+    // offsets of other classes, and to the file name in runtime errors. All
+    // of these are covered by hashing the shape of the whole hierarchy.
+    Fnv1a hash;
+    hash.add_string(file_name_);
+
+    int num_classes = class_table_->get_num_of_classes();
+    hash.add_int(num_classes);
+
+    for (int class_index = 0; class_index < num_classes; ++class_index)
+    {
+        hash.add_string(class_table_->get_name(class_index));
+        hash.add_int(class_table_->get_parent_index(class_index));
+        hash.add_int(class_table_->get_sub_hierarchy_size(class_index));
+
+        auto attributes = class_table_->get_all_attributes(class_index);
+        hash.add_int(static_cast<int64_t>(attributes.size()));
+        for (const auto &attribute : attributes)
+        {
+            hash.add_string(attribute);
+            hash.add_int(class_table_->transitive_get_attribute_type(class_index, attribute).value_or(NO_TYPE_INDEX));
+        }
+
+        auto methods = class_table_->get_all_methods(class_index);
+        hash.add_int(static_cast<int64_t>(methods.size()));
+        for (const auto &[method_name, defining_class] : methods)
+        {
+            hash.add_string(method_name);
+            hash.add_int(defining_class);
+
+            auto signature = class_table_->get_signature(defining_class, method_name);
+            hash.add_int(signature ? static_cast<int64_t>(signature->size()) : -1);
+            for (int type_index : signature.value_or(vector<int>{}))
+            {
+                hash.add_int(type_index);
+            }
+        }
+    }
+
+    return hash.get();
+}
+
+CoolCodegen::CachedClass *CoolCodegen::look_up_cached_class(int class_index, const string &class_name)
+{
+    if (class_cache_ == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto source_hash = class_source_hashes_.find(class_name);
+    if (source_hash == class_source_hashes_.end())
+    {
+        return nullptr;
+    }
+
+    Fnv1a key;
+    key.add_int(static_cast<int64_t>(class_cache_->get_compiler_stamp()));
+    key.add_int(static_cast<int64_t>(layout_hash_));
+    key.add_int(static_cast<int64_t>(source_hash->second));
+
+    CachedClass cached{key.get(), false, {}};
+    // The entry can't be used if one of its string labels has already gone to
+    // another string whose hash collides with it; the class is then generated
+    // again.
+    auto entry = class_cache_->load(cached.key);
+    if (entry && static_constants_.replay(entry->constants))
+    {
+        cached.hit = true;
+        cached.entry = move(*entry);
+    }
+
+    return &(cached_classes_[class_index] = move(cached));
+}
+
+void CoolCodegen::release_method_bodies(int class_index)
+{
+    for (const auto &method_name : class_table_->get_method_names(class_index))
+    {
+        class_table_->set_method_body(class_index, method_name, nullptr);
+    }
+}
+
+void CoolCodegen::release_attribute_initializers(int class_index, const string &class_name)
+{
+    // Initializers of inherited attributes run in the `_init` of the class
+    // that declares them, so only this class's own ones are done with.
+    for (const auto &attribute_name : class_table_->get_attributes(class_index))
+    {
+        class_table_->set_attribute_initializer(class_name, attribute_name, nullptr);
+    }
+}
@@ -5,7 +5,7 @@
 
 using namespace std;
 
-void ExpressionCodegen::generate(ostream &out, const Expr *expr)
+void ExpressionCodegen::generate(AsmWriter &out, const Expr *expr)
 {
     if (auto static_dispatch = dynamic_cast<const StaticDispatch *>(expr))
     {
@@ -115,13 +115,13 @@ void ExpressionCodegen::generate(ostream &out, const Expr *expr)
     riscv_emit::emit_comment(out, "TODO: unsupported expr");
 }
 
-void ExpressionCodegen::emit_string_constant(ostream &out, const StringConstant *string_constant)
+void ExpressionCodegen::emit_string_constant(AsmWriter &out, const StringConstant *string_constant)
 {
     string label = static_constants_->use_string_constant(string_constant->get_value());
     riscv_emit::emit_load_address(out, ArgumentRegister{0}, label);
 }
 
-void ExpressionCodegen::emit_static_dispatch(ostream &out, const StaticDispatch *expr)
+void ExpressionCodegen::emit_static_dispatch(AsmWriter &out, const StaticDispatch *expr)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Static Dispatch");
@@ -147,7 +147,7 @@ void ExpressionCodegen::emit_static_dispatch(ostream &out, const StaticDispatch
     riscv_emit::emit_jump_and_link(out, class_name + "." + method_name);
 }
 
-void ExpressionCodegen::emit_let_in(ostream &out, const LetIn *let_in)
+void ExpressionCodegen::emit_let_in(AsmWriter &out, const LetIn *let_in)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Let In");
@@ -180,7 +180,7 @@ void ExpressionCodegen::emit_let_in(ostream &out, const LetIn *let_in)
 
         int fp_offset = -frame_depth_bytes_;
         push_register(out, ArgumentRegister{0});
-        bind_var(vardecl->get_name(), fp_offset);
+        bind_var(symbols_.intern(vardecl->get_name()), fp_offset);
     }
 
     riscv_emit::emit_move(out, ArgumentRegister{0}, TempRegister{2});
@@ -192,7 +192,7 @@ void ExpressionCodegen::emit_let_in(ostream &out, const LetIn *let_in)
     end_scope();
 }
 
-void ExpressionCodegen::emit_new_object(ostream &out, const NewObject *new_object)
+void ExpressionCodegen::emit_new_object(AsmWriter &out, const NewObject *new_object)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "New Object");
@@ -210,7 +210,7 @@ void ExpressionCodegen::emit_new_object(ostream &out, const NewObject *new_objec
 }
 
 // Utils
-void ExpressionCodegen::push_register(ostream &out, Register reg)
+void ExpressionCodegen::push_register(AsmWriter &out, Register reg)
 {
     riscv_emit::emit_store_word(out, reg, MemoryLocation{0, StackPointer{}});
     riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, -4);
@@ -222,41 +222,68 @@ void ExpressionCodegen::pop_register(int words_count)
     frame_depth_bytes_ -= 4 * words_count;
 }
 
-void ExpressionCodegen::pop_words(ostream &out, int words_count)
+void ExpressionCodegen::pop_words(AsmWriter &out, int words_count)
 {
     riscv_emit::emit_add_immediate(out, StackPointer{}, StackPointer{}, 4 * words_count);
     frame_depth_bytes_ -= 4 * words_count;
 }
 
-void ExpressionCodegen::bind_var(const string &name, int fp_offset)
+void ExpressionCodegen::bind_var(Symbol name, int fp_offset)
 {
-    scopes_.back()[name] = fp_offset;
+    bindings_.emplace_back(name, fp_offset);
 }
 
-void ExpressionCodegen::begin_scope() { scopes_.push_back({}); }
-void ExpressionCodegen::end_scope() { scopes_.pop_back(); }
+void ExpressionCodegen::begin_scope() { scope_starts_.push_back(bindings_.size()); }
 
-int ExpressionCodegen::lookup_var(const string &name)
+void ExpressionCodegen::end_scope()
 {
-    for (int i = (int)scopes_.size() - 1; i >= 0; --i)
+    bindings_.resize(scope_starts_.back());
+    scope_starts_.pop_back();
+}
+
+int ExpressionCodegen::lookup_var(Symbol name) const
+{
+    for (auto it = bindings_.rbegin(); it != bindings_.rend(); ++it)
     {
-        auto it = scopes_[i].find(name);
-        if (it != scopes_[i].end())
+        if (it->first == name)
             return it->second;
     }
     return -1;
 }
 
+int ExpressionCodegen::get_attribute_slot(int class_index, Symbol name)
+{
+    if ((int)attribute_slots_.size() <= class_index)
+    {
+        attribute_slots_.resize(class_index + 1);
+    }
+
+    auto &cached = attribute_slots_[class_index];
+    if (!cached)
+    {
+        cached.emplace();
+        int slot = 0;
+        for (const auto &attribute : class_table_->get_all_attributes(class_index))
+        {
+            cached->try_emplace(symbols_.intern(attribute), slot++);
+        }
+    }
+
+    auto it = cached->find(name);
+    return it == cached->end() ? -1 : it->second;
+}
+
 void ExpressionCodegen::reset_frame()
 {
     frame_depth_bytes_ = 8;
-    scopes_.clear();
+    bindings_.clear();
+    scope_starts_.clear();
     begin_scope();
 }
 
 // end Utils
 
-void ExpressionCodegen::emit_dynamic_dispatch(ostream &out, const DynamicDispatch *expr)
+void ExpressionCodegen::emit_dynamic_dispatch(AsmWriter &out, const DynamicDispatch *expr)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Dynamic Dispatch");
@@ -285,11 +312,11 @@ void ExpressionCodegen::emit_dynamic_dispatch(ostream &out, const DynamicDispatc
     pop_words(out, 1);
 }
 
-void ExpressionCodegen::emit_object_reference(ostream &out, const ObjectReference *object_reference)
+void ExpressionCodegen::emit_object_reference(AsmWriter &out, const ObjectReference *object_reference)
 {
-    string name = object_reference->get_name();
+    Symbol name = symbols_.intern(object_reference->get_name());
 
-    if (name == "self")
+    if (name == self_symbol_)
     {
         riscv_emit::emit_move(out, ArgumentRegister{0}, SavedRegister{1});
         return;
@@ -303,17 +330,7 @@ void ExpressionCodegen::emit_object_reference(ostream &out, const ObjectReferenc
         return;
     }
 
-    auto all_attrs = class_table_->get_all_attributes(current_class_index_);
-
-    int attr_i = -1;
-    for (int i = 0; i < (int)all_attrs.size(); ++i)
-    {
-        if (all_attrs[i] == name)
-        {
-            attr_i = i;
-            break;
-        }
-    }
+    int attr_i = get_attribute_slot(current_class_index_, name);
 
     if (attr_i < 0)
     {
@@ -326,7 +343,7 @@ void ExpressionCodegen::emit_object_reference(ostream &out, const ObjectReferenc
     riscv_emit::emit_load_word(out, ArgumentRegister{0}, MemoryLocation{byte_offset, SavedRegister{1}});
 }
 
-void ExpressionCodegen::emit_sequence(ostream &out, const Sequence *sequence)
+void ExpressionCodegen::emit_sequence(AsmWriter &out, const Sequence *sequence)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Sequence");
@@ -336,36 +353,29 @@ void ExpressionCodegen::emit_sequence(ostream &out, const Sequence *sequence)
     }
 }
 
-void ExpressionCodegen::emit_int_constant(ostream &out, const IntConstant *int_constant)
+void ExpressionCodegen::emit_int_constant(AsmWriter &out, const IntConstant *int_constant)
 {
     string label = static_constants_->use_int_constant(int_constant->get_value());
     riscv_emit::emit_load_address(out, ArgumentRegister{0}, label);
 }
 
-void ExpressionCodegen::emit_assignment(ostream &out, const Assignment *assignment)
+void ExpressionCodegen::emit_assignment(AsmWriter &out, const Assignment *assignment)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Assignment");
 
     generate(out, assignment->get_value());
 
-    int fp_offset = lookup_var(assignment->get_assignee_name());
+    Symbol name = symbols_.intern(assignment->get_assignee_name());
+
+    int fp_offset = lookup_var(name);
     if (fp_offset != -1)
     {
         riscv_emit::emit_store_word(out, ArgumentRegister{0}, MemoryLocation{fp_offset, FramePointer{}});
         return;
     }
 
-    auto all_attrs = class_table_->get_all_attributes(current_class_index_);
-    int attr_i = -1;
-    for (int i = 0; i < (int)all_attrs.size(); ++i)
-    {
-        if (all_attrs[i] == assignment->get_assignee_name())
-        {
-            attr_i = i;
-            break;
-        }
-    }
+    int attr_i = get_attribute_slot(current_class_index_, name);
 
     if (attr_i < 0)
     {
@@ -377,7 +387,7 @@ void ExpressionCodegen::emit_assignment(ostream &out, const Assignment *assignme
     riscv_emit::emit_store_word(out, ArgumentRegister{0}, MemoryLocation{byte_offset, SavedRegister{1}});
 }
 
-void ExpressionCodegen::emit_method_invocation(ostream &out, const MethodInvocation *mi)
+void ExpressionCodegen::emit_method_invocation(AsmWriter &out, const MethodInvocation *mi)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Method Invocation");
@@ -406,27 +416,18 @@ void ExpressionCodegen::emit_method_invocation(ostream &out, const MethodInvocat
 }
 
 void ExpressionCodegen::emit_attributes(
-    ostream &out,
+    AsmWriter &out,
     const vector<string> &attribute_names,
     int class_index)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Init attributes");
 
-    auto all_attrs = class_table_->get_all_attributes(class_index);
     const string current_class_name(class_table_->get_name(class_index));
 
     for (const string &attr_name : attribute_names)
     {
-        int pos = -1;
-        for (int i = 0; i < (int)all_attrs.size(); ++i)
-        {
-            if (all_attrs[i] == attr_name)
-            {
-                pos = i;
-                break;
-            }
-        }
+        int pos = get_attribute_slot(class_index, symbols_.intern(attr_name));
         if (pos < 0)
             continue;
 
@@ -470,19 +471,19 @@ void ExpressionCodegen::bind_formals(const vector<string> &formals)
     int offset = 4;
     for (const auto &name : formals)
     {
-        bind_var(name, offset);
+        bind_var(symbols_.intern(name), offset);
         offset += 4;
     }
 }
 
-void ExpressionCodegen::emit_if_then_else_fi(ostream &out, const IfThenElseFi *if_then_else_fi)
+void ExpressionCodegen::emit_if_then_else_fi(AsmWriter &out, const IfThenElseFi *if_then_else_fi)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "If Then Else Fi");
 
-    int id = riscv_emit::if_then_else_fi_label_count++;
-    string else_lbl = "else_branch_" + to_string(id);
-    string fi_lbl = "fi_end_" + to_string(id);
+    int id = context_->if_then_else_fi_label_count++;
+    string else_lbl = local_label("else_branch_", id);
+    string fi_lbl = local_label("fi_end_", id);
 
     generate(out, if_then_else_fi->get_condition());
 
@@ -498,22 +499,22 @@ void ExpressionCodegen::emit_if_then_else_fi(ostream &out, const IfThenElseFi *i
     riscv_emit::emit_label(out, fi_lbl);
 }
 
-void ExpressionCodegen::emit_bool_constant(ostream &out, const BoolConstant *bool_constant)
+void ExpressionCodegen::emit_bool_constant(AsmWriter &out, const BoolConstant *bool_constant)
 {
     string label = static_constants_->use_bool_constant(bool_constant->get_value());
     riscv_emit::emit_load_address(out, ArgumentRegister{0}, label);
 }
 
-void ExpressionCodegen::emit_is_void(ostream &out, const IsVoid *is_void)
+void ExpressionCodegen::emit_is_void(AsmWriter &out, const IsVoid *is_void)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "IsVoid");
 
     generate(out, is_void->get_subject());
 
-    int id = riscv_emit::if_then_else_fi_label_count++;
-    string true_lbl = "isvoid_true_" + to_string(id);
-    string end_lbl = "isvoid_end_" + to_string(id);
+    int id = context_->if_then_else_fi_label_count++;
+    string true_lbl = local_label("isvoid_true_", id);
+    string end_lbl = local_label("isvoid_end_", id);
 
     riscv_emit::emit_branch_equal_zero(out, ArgumentRegister{0}, true_lbl);
 
@@ -526,7 +527,7 @@ void ExpressionCodegen::emit_is_void(ostream &out, const IsVoid *is_void)
     riscv_emit::emit_label(out, end_lbl);
 }
 
-void ExpressionCodegen::emit_integer_comparison(ostream &out, const IntegerComparison *integer_comparison)
+void ExpressionCodegen::emit_integer_comparison(AsmWriter &out, const IntegerComparison *integer_comparison)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Integer Comparison");
@@ -561,9 +562,9 @@ void ExpressionCodegen::emit_integer_comparison(ostream &out, const IntegerCompa
         break;
     }
 
-    int id = riscv_emit::if_then_else_fi_label_count++;
-    string false_lbl = "int_comp_false_" + to_string(id);
-    string end_lbl = "int_comp_end_" + to_string(id);
+    int id = context_->if_then_else_fi_label_count++;
+    string false_lbl = local_label("int_comp_false_", id);
+    string end_lbl = local_label("int_comp_end_", id);
 
     riscv_emit::emit_branch_equal_zero(out, TempRegister{2}, false_lbl);
     riscv_emit::emit_load_address(out, ArgumentRegister{0}, static_constants_->use_bool_constant(true));
@@ -575,7 +576,7 @@ void ExpressionCodegen::emit_integer_comparison(ostream &out, const IntegerCompa
     riscv_emit::emit_label(out, end_lbl);
 }
 
-void ExpressionCodegen::emit_equality_comparison(ostream &out, const EqualityComparison *equality_comparison)
+void ExpressionCodegen::emit_equality_comparison(AsmWriter &out, const EqualityComparison *equality_comparison)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Equality Comparison");
@@ -589,21 +590,21 @@ void ExpressionCodegen::emit_equality_comparison(ostream &out, const EqualityCom
     riscv_emit::emit_load_word(out, TempRegister{0}, MemoryLocation{4, StackPointer{}}); // t0 = lhs
     pop_words(out, 1);
 
-    const int id = riscv_emit::if_then_else_fi_label_count++;
+    const int id = context_->if_then_else_fi_label_count++;
 
-    const string ret_true = "eq_true_" + to_string(id);
-    const string ret_false = "eq_false_" + to_string(id);
-    const string end_lbl = "eq_end_" + to_string(id);
+    const string ret_true = local_label("eq_true_", id);
+    const string ret_false = local_label("eq_false_", id);
+    const string end_lbl = local_label("eq_end_", id);
 
-    const string lhs_void_lbl = "eq_lhs_void_" + to_string(id);
-    const string after_void = "eq_after_void_" + to_string(id);
+    const string lhs_void_lbl = local_label("eq_lhs_void_", id);
+    const string after_void = local_label("eq_after_void_", id);
 
-    const string check_int = "eq_check_int_" + to_string(id);
-    const string check_bool = "eq_check_bool_" + to_string(id);
-    const string check_string = "eq_check_string_" + to_string(id);
+    const string check_int = local_label("eq_check_int_", id);
+    const string check_bool = local_label("eq_check_bool_", id);
+    const string check_string = local_label("eq_check_string_", id);
 
-    const string str_loop = "eq_str_loop_" + to_string(id);
-    const string str_ok = "eq_str_ok_" + to_string(id);
+    const string str_loop = local_label("eq_str_loop_", id);
+    const string str_ok = local_label("eq_str_ok_", id);
 
     riscv_emit::emit_subtract(out, TempRegister{4}, TempRegister{0}, TempRegister{1});
     riscv_emit::emit_set_equal_zero(out, TempRegister{4}, TempRegister{4});
@@ -697,14 +698,14 @@ void ExpressionCodegen::emit_equality_comparison(ostream &out, const EqualityCom
     riscv_emit::emit_label(out, end_lbl);
 }
 
-void ExpressionCodegen::emit_while_loop_pool(ostream &out, const WhileLoopPool *w)
+void ExpressionCodegen::emit_while_loop_pool(AsmWriter &out, const WhileLoopPool *w)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "While Loop");
 
-    int id = riscv_emit::while_loop_pool_label_count++;
-    string begin_lbl = "while_begin_" + to_string(id);
-    string end_lbl = "while_end_" + to_string(id);
+    int id = context_->while_loop_pool_label_count++;
+    string begin_lbl = local_label("while_begin_", id);
+    string end_lbl = local_label("while_end_", id);
 
     riscv_emit::emit_label(out, begin_lbl);
 
@@ -722,7 +723,7 @@ void ExpressionCodegen::emit_while_loop_pool(ostream &out, const WhileLoopPool *
     riscv_emit::emit_move(out, ArgumentRegister{0}, ZeroRegister{});
 }
 
-void ExpressionCodegen::emit_integer_negation(ostream &out, const IntegerNegation *integer_negation)
+void ExpressionCodegen::emit_integer_negation(AsmWriter &out, const IntegerNegation *integer_negation)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Integer Negation");
@@ -741,7 +742,7 @@ void ExpressionCodegen::emit_integer_negation(ostream &out, const IntegerNegatio
     riscv_emit::emit_store_word(out, TempRegister{3}, MemoryLocation{12, ArgumentRegister{0}});
 }
 
-void ExpressionCodegen::emit_boolean_negation(ostream &out, const BooleanNegation *boolean_negation)
+void ExpressionCodegen::emit_boolean_negation(AsmWriter &out, const BooleanNegation *boolean_negation)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Boolean Negation");
@@ -759,7 +760,7 @@ void ExpressionCodegen::emit_boolean_negation(ostream &out, const BooleanNegatio
     riscv_emit::emit_store_word(out, TempRegister{3}, MemoryLocation{12, ArgumentRegister{0}});
 }
 
-void ExpressionCodegen::emit_arithmetic(ostream &out, const Arithmetic *arithmetic)
+void ExpressionCodegen::emit_arithmetic(AsmWriter &out, const Arithmetic *arithmetic)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Arithmetic");
@@ -803,12 +804,12 @@ void ExpressionCodegen::emit_arithmetic(ostream &out, const Arithmetic *arithmet
     riscv_emit::emit_store_word(out, SavedRegister{2}, MemoryLocation{12, ArgumentRegister{0}});
 }
 
-void ExpressionCodegen::emit_parenthesized_expr(ostream &out, const ParenthesizedExpr *parenthesized_expr)
+void ExpressionCodegen::emit_parenthesized_expr(AsmWriter &out, const ParenthesizedExpr *parenthesized_expr)
 {
     generate(out, parenthesized_expr->get_contents());
 }
 
-void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
+void ExpressionCodegen::emit_case_of_esac(AsmWriter &out, const CaseOfEsac *e)
 {
     riscv_emit::emit_empty_line(out);
     riscv_emit::emit_comment(out, "Case Of Esac");
@@ -816,10 +817,10 @@ void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
     generate(out, e->get_multiplex());
     riscv_emit::emit_move(out, TempRegister{0}, ArgumentRegister{0}); // save obj
 
-    int id = riscv_emit::case_of_esac_count++;
-    string end_lbl = "case_end_" + to_string(id);
-    string void_lbl = "case_void_" + to_string(id);
-    string no_match_lbl = "case_no_match_" + to_string(id);
+    int id = context_->case_of_esac_count++;
+    string end_lbl = local_label("case_end_", id);
+    string void_lbl = local_label("case_void_", id);
+    string no_match_lbl = local_label("case_no_match_", id);
 
     riscv_emit::emit_branch_equal_zero(out, TempRegister{0}, void_lbl);
 
@@ -830,16 +831,24 @@ void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
     for (const auto &cs : e->get_cases())
         cases.push_back(&cs);
 
+    // normalize_indexes gave every class and its heirs consecutive indices,
+    // so the heirs of T are the tags from T up to T + its sub-hierarchy size.
+    auto is_heir = [this](int type, int ancestor)
+    {
+        return ancestor <= type &&
+               type < ancestor + class_table_->get_sub_hierarchy_size(ancestor);
+    };
+
     sort(cases.begin(), cases.end(),
-         [this](const CaseOfEsac::Case *a, const CaseOfEsac::Case *b)
+         [&is_heir](const CaseOfEsac::Case *a, const CaseOfEsac::Case *b)
          {
              int ta = a->get_type();
              int tb = b->get_type();
              if (ta == tb)
                  return false;
 
-             bool a_sub_b = class_table_->is_subclass_of(ta, tb);
-             bool b_sub_a = class_table_->is_subclass_of(tb, ta);
+             bool a_sub_b = is_heir(ta, tb);
+             bool b_sub_a = is_heir(tb, ta);
 
              if (a_sub_b != b_sub_a)
                  return a_sub_b;
@@ -850,29 +859,11 @@ void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
     {
         int T = cs->get_type();
 
-        string br_lbl = "case_branch_" + to_string(id) + "_" + to_string(T);
+        string br_lbl = local_label("case_branch_", id) + "_" + to_string(T);
         string next_lbl = br_lbl + "_next";
 
-        int min_tag = T, max_tag = T;
-        bool first = true;
-
-        int n = class_table_->get_num_of_classes();
-        for (int c = 0; c < n; ++c)
-        {
-            if (class_table_->is_subclass_of(c, T))
-            {
-                if (first)
-                {
-                    min_tag = max_tag = c;
-                    first = false;
-                }
-                else
-                {
-                    min_tag = min(min_tag, c);
-                    max_tag = max(max_tag, c);
-                }
-            }
-        }
+        int min_tag = T;
+        int max_tag = T + class_table_->get_sub_hierarchy_size(T) - 1;
 
         riscv_emit::emit_add_immediate(out, TempRegister{2}, ZeroRegister{}, min_tag);
         riscv_emit::emit_subtract(out, TempRegister{3}, TempRegister{1}, TempRegister{2});
@@ -891,7 +882,7 @@ void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
     for (const auto *cs : cases)
     {
         int T = cs->get_type();
-        string br_lbl = "case_branch_" + to_string(id) + "_" + to_string(T);
+        string br_lbl = local_label("case_branch_", id) + "_" + to_string(T);
         riscv_emit::emit_label(out, br_lbl);
 
         begin_scope();
@@ -900,7 +891,7 @@ void ExpressionCodegen::emit_case_of_esac(ostream &out, const CaseOfEsac *e)
         int fp_offset = -frame_depth_bytes_;
         riscv_emit::emit_move(out, ArgumentRegister{0}, TempRegister{0});
         push_register(out, ArgumentRegister{0});
-        bind_var(cs->get_name(), fp_offset);
+        bind_var(symbols_.intern(cs->get_name()), fp_offset);
 
         generate(out, cs->get_expr());
 
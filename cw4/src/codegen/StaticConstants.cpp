@@ -1,22 +1,61 @@
 #include "StaticConstants.h"
 
 #include "codegen/CodeEmitter.h"
+#include "util/Fnv1a.h"
+#include <charconv>
 #include <cmath>
 
 using namespace std;
 
 string StaticConstants::use_string_constant(const string &str)
 {
-    if (string_to_label.find(str) == string_to_label.end())
+    auto it = string_to_label.find(str);
+    if (it == string_to_label.end())
     {
-        string label = "str_const_" + to_string(next_string_id++);
-        string_to_label[str] = label;
+        string label;
+        if (content_labels_)
+        {
+            // Named after the contents rather than the order of first use, so a
+            // constant gets the same label no matter which code asks for it
+            // first. Strings whose hashes collide get a suffix, in the order
+            // they are first used.
+            Fnv1a content_hash;
+            content_hash.add_string(str);
+
+            char digits[16];
+            auto digits_end = to_chars(digits, digits + 16, content_hash.get(), 16).ptr;
+            string base = "str_const_" + string(digits, digits_end);
+
+            label = base;
+            for (int suffix = 1; label_to_string.count(label); ++suffix)
+            {
+                label = base + "_" + to_string(suffix);
+            }
+        }
+        else
+        {
+            label = "str_const_" + to_string(next_string_id++);
+        }
+
+        label_to_string.emplace(label, str);
+        it = string_to_label.emplace(str, label).first;
+    }
+
+    if (recording_)
+    {
+        recording_->strings.emplace_back(str, it->second);
     }
-    return string_to_label[str] + ".content";
+    return it->second + ".content";
 }
 
 string StaticConstants::use_bool_constant(bool value)
 {
+    if (recording_)
+    {
+        recording_->true_used = recording_->true_used || value;
+        recording_->false_used = recording_->false_used || !value;
+    }
+
     is_true_used = is_true_used || value;
     is_false_used = is_false_used || !value;
     return value ? "bool_const_true" : "bool_const_false";
@@ -24,6 +63,11 @@ string StaticConstants::use_bool_constant(bool value)
 
 string StaticConstants::use_int_constant(int value)
 {
+    if (recording_)
+    {
+        recording_->ints.push_back(value);
+    }
+
     if (int_to_label.find(value) == int_to_label.end())
     {
         string label = "int_const_" + to_string(value);
@@ -32,7 +76,52 @@ string StaticConstants::use_int_constant(int value)
     return int_to_label[value];
 }
 
-void StaticConstants::emit_all(ostream &out)
+bool StaticConstants::replay(const Uses &uses)
+{
+    for (const auto &[str, label] : uses.strings)
+    {
+        auto by_string = string_to_label.find(str);
+        if (by_string != string_to_label.end())
+        {
+            if (by_string->second != label)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        auto by_label = label_to_string.find(label);
+        if (by_label != label_to_string.end() && by_label->second != str)
+        {
+            return false;
+        }
+    }
+
+    for (const auto &[str, label] : uses.strings)
+    {
+        if (recording_)
+        {
+            recording_->strings.emplace_back(str, label);
+        }
+        label_to_string.emplace(label, str);
+        string_to_label.emplace(str, label);
+    }
+    for (int value : uses.ints)
+    {
+        use_int_constant(value);
+    }
+    if (uses.true_used)
+    {
+        use_bool_constant(true);
+    }
+    if (uses.false_used)
+    {
+        use_bool_constant(false);
+    }
+    return true;
+}
+
+void StaticConstants::emit_all(AsmWriter &out)
 {
     riscv_emit::emit_header_comment(out, "Static Constants");
 
@@ -0,0 +1,136 @@
+#include "debug/PhaseTimer.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+
+thread_local unsigned long long thread_allocations = 0;
+
+} // namespace
+
+// Replacing the global allocation functions is the only way to see the
+// allocations made inside the ANTLR runtime as well as our own.
+void *operator new(size_t size) {
+    ++thread_allocations;
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    while (true) {
+        if (void *ptr = malloc(size)) {
+            return ptr;
+        }
+
+        auto handler = get_new_handler();
+        if (handler == nullptr) {
+            throw bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+unsigned long long allocation_count() { return thread_allocations; }
+
+long peak_rss_kb() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // On Linux ru_maxrss is already in kilobytes.
+    return usage.ru_maxrss;
+}
+
+void PhaseTimer::begin(string name) {
+    current_name_ = std::move(name);
+    current_allocations_ = allocation_count();
+    current_start_ = chrono::steady_clock::now();
+}
+
+void PhaseTimer::end() {
+    auto finish = chrono::steady_clock::now();
+    auto allocations_in_phase = allocation_count() - current_allocations_;
+
+    chrono::duration<double, milli> wall = finish - current_start_;
+    phases_.push_back(Phase{std::move(current_name_), wall.count(),
+                            allocations_in_phase, peak_rss_kb()});
+}
+
+void PhaseTimer::split_off(string name, double wall_ms,
+                           unsigned long long allocations) {
+    auto &outer = phases_.back();
+    outer.wall_ms -= wall_ms;
+    outer.allocations -= allocations;
+
+    Phase inner{std::move(name), wall_ms, allocations, outer.peak_rss_kb};
+    phases_.insert(phases_.end() - 1, std::move(inner));
+}
+
+void PhaseTimer::print_text(ostream &out) const {
+    double total_ms = 0;
+    unsigned long long total_allocations = 0;
+
+    out << left << setw(20) << "phase" << right << setw(12) << "wall (ms)"
+        << setw(14) << "allocations" << setw(16) << "peak RSS (KiB)"
+        << '\n';
+
+    for (const auto &phase : phases_) {
+        out << left << setw(20) << phase.name << right << setw(12) << fixed
+            << setprecision(3) << phase.wall_ms << setw(14)
+            << phase.allocations << setw(16) << phase.peak_rss_kb << '\n';
+
+        total_ms += phase.wall_ms;
+        total_allocations += phase.allocations;
+    }
+
+    out << left << setw(20) << "total" << right << setw(12) << fixed
+        << setprecision(3) << total_ms << setw(14) << total_allocations
+        << setw(16) << peak_rss_kb() << endl;
+}
+
+void PhaseTimer::print_json(ostream &out, const string &file_name) const {
+    double total_ms = 0;
+    unsigned long long total_allocations = 0;
+
+    out << "{\"file\":\"";
+    for (char c : file_name) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (byte < 0x20) {
+            static constexpr char HEX[] = "0123456789abcdef";
+            out << "\\u00" << HEX[byte >> 4] << HEX[byte & 0xf];
+        } else {
+            out << c;
+        }
+    }
+    out << "\",\"phases\":[";
+
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        const auto &phase = phases_[i];
+        if (i != 0) {
+            out << ',';
+        }
+        out << "{\"name\":\"" << phase.name << "\",\"wall_ms\":" << fixed
+            << setprecision(3) << phase.wall_ms
+            << ",\"allocations\":" << phase.allocations
+            << ",\"peak_rss_kb\":" << phase.peak_rss_kb << '}';
+
+        total_ms += phase.wall_ms;
+        total_allocations += phase.allocations;
+    }
+
+    out << "],\"total\":{\"wall_ms\":" << fixed << setprecision(3) << total_ms
+        << ",\"allocations\":" << total_allocations
+        << ",\"peak_rss_kb\":" << peak_rss_kb() << "}}" << endl;
+}
@@ -0,0 +1,292 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CoolLexer.h"
+#include "CoolParser.h"
+#include "antlr4-runtime/antlr4-runtime.h"
+
+#include "semantics/CoolSemantics.h"
+
+#include "bench/ProgramGenerator.h"
+#include "codegen/AsmWriter.h"
+#include "codegen/CoolCodegen.h"
+#include "debug/ParseClock.h"
+#include "debug/PhaseTimer.h"
+#include "util/TwoStageParse.h"
+
+using namespace std;
+using namespace antlr4;
+
+// Compile-throughput benchmarks on synthetic programs. Every shape from
+// ProgramGenerator is compiled at a quarter, half and all of its size, and
+// the growth of each phase between the last two sizes is reported as an
+// exponent, so that a phase that went quadratic stands out even when its
+// absolute time is still small.
+
+struct BenchOptions {
+    string filter;
+    double min_time_s = 0.5;
+    double scale = 1.0;
+
+    // `--emit <shape> <size>` prints a generated program instead.
+    optional<ProgramShape> emit_shape;
+    size_t emit_size = 0;
+};
+
+// Phases slower than this grow too fast to be linear, with some slack for
+// noise and for the log factors of hash tables and sorting.
+constexpr double SUPERLINEAR_EXPONENT = 1.4;
+
+static void print_usage(const char *program) {
+    cerr << "Usage: " << program
+         << " [--filter <substring>] [--min-time <seconds>] [--scale <factor>]\n"
+         << "       " << program << " --emit <shape> <size>\n"
+         << "Shapes:";
+    for (const auto &info : all_program_shapes()) {
+        cerr << ' ' << info.name;
+    }
+    cerr << endl;
+}
+
+static optional<BenchOptions> parse_options(int argc, const char *argv[]) {
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+        if (arg == "--emit") {
+            if (i + 2 >= argc) {
+                return nullopt;
+            }
+            options.emit_shape = program_shape_from_name(argv[++i]);
+            options.emit_size = strtoul(argv[++i], nullptr, 10);
+            if (!options.emit_shape) {
+                return nullopt;
+            }
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            return nullopt;
+        }
+        if (arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time") {
+            options.min_time_s = strtod(argv[++i], nullptr);
+        } else if (arg == "--scale") {
+            options.scale = strtod(argv[++i], nullptr);
+        } else {
+            return nullopt;
+        }
+    }
+
+    return options;
+}
+
+// Compiles `source` once and returns the time of each phase, or nullopt if
+// the program was rejected, which means the generator is broken.
+static optional<vector<PhaseTimer::Phase>>
+compile_once(const string &source, const string &name) {
+    PhaseTimer timer;
+
+    ANTLRInputStream input(source);
+    CoolLexer lexer(&input);
+    CommonTokenStream tokenStream(&lexer);
+    CoolParser parser(&tokenStream);
+
+    {
+        PhaseScope phase(&timer, "lex");
+        tokenStream.fill();
+    }
+
+    // The same phases as --time-report: the parse that semantics runs is
+    // timed from inside it and split off into a phase of its own.
+    optional<CoolSemantics> semantics;
+    ParseClock parse_clock;
+    parser.addParseListener(&parse_clock);
+
+    auto semantics_result = [&] {
+        PhaseScope phase(&timer, "semantics");
+        bool fell_back;
+        return parse_sll_then_ll(parser, fell_back, [&] {
+            return semantics.emplace(&lexer, &parser).run();
+        });
+    }();
+
+    parser.removeParseListener(&parse_clock);
+    timer.split_off("parse", parse_clock.wall_ms, parse_clock.allocations);
+
+    if (!semantics_result.has_value()) {
+        cerr << name << " was rejected:\n";
+        for (const auto &error : semantics_result.error()) {
+            cerr << "  " << error << '\n';
+        }
+        return nullopt;
+    }
+
+    CoolCodegen codegen(name + ".cl", std::move(semantics_result.value()));
+
+    AsmWriter out;
+    codegen.generate(out, &timer);
+    out.take_text();
+
+    return timer.get_phases();
+}
+
+struct Measurement {
+    size_t size;
+    size_t iterations;
+    // Mean wall time of each phase, in the order the phases ran.
+    vector<pair<string, double>> phase_ms;
+    double total_ms;
+};
+
+static optional<Measurement> measure(ProgramShape shape, string_view shape_name,
+                                     size_t size, double min_time_s) {
+    auto source = generate_program(shape, size);
+    auto name = string(shape_name) + "_" + to_string(size);
+
+    Measurement measurement{size, 0, {}, 0};
+    map<string, double> sums;
+
+    auto start = chrono::steady_clock::now();
+    do {
+        auto phases = compile_once(source, name);
+        if (!phases) {
+            return nullopt;
+        }
+
+        for (const auto &phase : *phases) {
+            if (measurement.iterations == 0) {
+                measurement.phase_ms.emplace_back(phase.name, 0);
+            }
+            sums[phase.name] += phase.wall_ms;
+        }
+        ++measurement.iterations;
+    } while (chrono::duration<double>(chrono::steady_clock::now() - start)
+                 .count() < min_time_s);
+
+    for (auto &[phase_name, ms] : measurement.phase_ms) {
+        ms = sums[phase_name] / measurement.iterations;
+        measurement.total_ms += ms;
+    }
+
+    return measurement;
+}
+
+static void print_header(const Measurement &measurement) {
+    cout << left << setw(28) << "benchmark" << right << setw(8) << "iters";
+    for (const auto &[phase_name, ms] : measurement.phase_ms) {
+        cout << setw(15) << phase_name;
+    }
+    cout << setw(12) << "total" << '\n';
+}
+
+static void print_measurement(string_view shape_name,
+                              const Measurement &measurement) {
+    auto label = string(shape_name) + "/" + to_string(measurement.size);
+    cout << left << setw(28) << label << right << setw(8)
+         << measurement.iterations << fixed << setprecision(3);
+    for (const auto &[phase_name, ms] : measurement.phase_ms) {
+        cout << setw(15) << ms;
+    }
+    cout << setw(12) << measurement.total_ms << '\n';
+}
+
+// Prints the exponent k in time ~ size^k for each phase, estimated from the
+// two largest sizes. Returns whether any phase grew superlinearly.
+static bool print_growth(string_view shape_name, const Measurement &smaller,
+                         const Measurement &larger) {
+    auto exponent = [&](double small_ms, double large_ms) {
+        // Phases that take next to no time are all noise.
+        constexpr double MIN_MS = 0.05;
+        if (small_ms < MIN_MS || large_ms < MIN_MS) {
+            return 0.0;
+        }
+        return log(large_ms / small_ms) /
+               log(double(larger.size) / double(smaller.size));
+    };
+
+    bool superlinear = false;
+    auto label = string(shape_name) + "/growth";
+    cout << left << setw(28) << label << right << setw(8) << "" << fixed
+         << setprecision(2);
+    for (size_t i = 0; i < larger.phase_ms.size(); ++i) {
+        double k = exponent(smaller.phase_ms[i].second,
+                            larger.phase_ms[i].second);
+        superlinear = superlinear || k > SUPERLINEAR_EXPONENT;
+
+        auto cell = "n^" + to_string(k).substr(0, 4);
+        if (k > SUPERLINEAR_EXPONENT) {
+            cell += " !";
+        }
+        cout << setw(15) << cell;
+    }
+    double k = exponent(smaller.total_ms, larger.total_ms);
+    cout << setw(12) << "n^" + to_string(k).substr(0, 4) << "\n\n";
+
+    return superlinear;
+}
+
+int main(int argc, const char *argv[]) {
+    auto options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (options->emit_shape) {
+        cout << generate_program(*options->emit_shape, options->emit_size);
+        return 0;
+    }
+
+    bool header_printed = false;
+    vector<string_view> superlinear_shapes;
+
+    for (const auto &info : all_program_shapes()) {
+        if (info.name.find(options->filter) == string_view::npos) {
+            continue;
+        }
+
+        auto full_size = max<size_t>(4, info.default_size * options->scale);
+
+        vector<Measurement> measurements;
+        for (size_t size : {full_size / 4, full_size / 2, full_size}) {
+            auto measurement =
+                measure(info.shape, info.name, size, options->min_time_s);
+            if (!measurement) {
+                return 1;
+            }
+
+            if (!header_printed) {
+                print_header(*measurement);
+                header_printed = true;
+            }
+            print_measurement(info.name, *measurement);
+            cout.flush();
+
+            measurements.push_back(std::move(*measurement));
+        }
+
+        if (print_growth(info.name, measurements[1], measurements[2])) {
+            superlinear_shapes.push_back(info.name);
+        }
+    }
+
+    if (!superlinear_shapes.empty()) {
+        cout << "Superlinear phases (marked with !) in:";
+        for (auto name : superlinear_shapes) {
+            cout << ' ' << name;
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
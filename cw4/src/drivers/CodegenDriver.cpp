@@ -1,14 +1,24 @@
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <expected>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "CoolLexer.h"
 #include "CoolParser.h"
 #include "antlr4-runtime/antlr4-runtime.h"
@@ -16,7 +26,17 @@
 #include "semantics/ClassTable.h"
 #include "semantics/CoolSemantics.h"
 
+#include "codegen/AsmWriter.h"
+#include "codegen/ClassCache.h"
 #include "codegen/CoolCodegen.h"
+#include "debug/ParseClock.h"
+#include "debug/PhaseTimer.h"
+#include "lexer/CoolToken.h"
+#include "lexer/FastCoolLexer.h"
+#include "util/MappedCharStream.h"
+#include "util/TwoStageParse.h"
+#include "util/WarmupCorpus.h"
+#include "util/WorkStealingPool.h"
 
 using namespace std;
 using namespace antlr4;
@@ -24,45 +44,638 @@ using namespace antlr4::tree;
 
 namespace fs = filesystem;
 
-int main(int argc, const char *argv[]) {
-    if (argc != 2) {
-        cerr << "Expecting exactly one argument: name of input file" << endl;
-        return 1;
+enum class TimeReport { None, Text, Json };
+
+struct Options {
+    TimeReport time_report = TimeReport::None;
+    bool pipeline = false;
+    bool fast_lexer = false;
+    bool dump_tokens = false;
+    bool parse_stats = false;
+
+    bool batch = false;
+    bool server = false;
+    size_t jobs = 0;
+    fs::path output_dir = ".";
+    optional<fs::path> cache_dir;
+
+    vector<string> files;
+};
+
+static void print_usage(const char *program) {
+    cerr << "Usage: " << program
+         << " [--fast-lexer] [--pipeline] [--parse-stats] [--cache-dir <dir>] "
+            "[--time-report[=json]] <file>\n"
+         << "       " << program
+         << " [--fast-lexer] [--pipeline] [--parse-stats] [--cache-dir <dir>] "
+            "--batch [-j <jobs>] [-o <output dir>] <file>...\n"
+         << "       " << program
+         << " [--fast-lexer] [--pipeline] [--parse-stats] [--cache-dir <dir>] "
+            "--server\n"
+         << "       " << program << " [--fast-lexer] --dump-tokens <file>"
+         << endl;
+}
+
+static optional<Options> parse_options(int argc, const char *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+        if (arg == "--time-report" || arg == "--time-report=text") {
+            options.time_report = TimeReport::Text;
+        } else if (arg == "--time-report=json") {
+            options.time_report = TimeReport::Json;
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--fast-lexer") {
+            options.fast_lexer = true;
+        } else if (arg == "--dump-tokens") {
+            options.dump_tokens = true;
+        } else if (arg == "--parse-stats") {
+            options.parse_stats = true;
+        } else if (arg == "--batch") {
+            options.batch = true;
+        } else if (arg == "--server") {
+            options.server = true;
+        } else if (arg == "-j" || arg == "-o" || arg == "--cache-dir") {
+            if (i + 1 == argc) {
+                return nullopt;
+            }
+            if (arg == "--cache-dir") {
+                options.cache_dir = argv[++i];
+                continue;
+            }
+            if (arg == "-o") {
+                options.output_dir = argv[++i];
+                continue;
+            }
+
+            char *end = nullptr;
+            options.jobs = strtoul(argv[++i], &end, 10);
+            if (*end != '\0') {
+                return nullopt;
+            }
+        } else if (arg.starts_with("-")) {
+            return nullopt;
+        } else {
+            options.files.emplace_back(arg);
+        }
+    }
+
+    if (options.dump_tokens) {
+        if (options.batch || options.server || options.files.size() != 1 ||
+            options.time_report != TimeReport::None || options.parse_stats) {
+            return nullopt;
+        }
+        return options;
+    }
+
+    if (options.server) {
+        if (options.batch || !options.files.empty() ||
+            options.time_report != TimeReport::None) {
+            return nullopt;
+        }
+        return options;
+    }
+
+    if (options.files.empty()) {
+        return nullopt;
+    }
+    if (!options.batch && options.files.size() != 1) {
+        return nullopt;
+    }
+    // Per-phase numbers are process-wide, so they mean nothing when several
+    // files are compiled at the same time.
+    if (options.batch && options.time_report != TimeReport::None) {
+        return nullopt;
+    }
+
+    return options;
+}
+
+// Everything that is only needed until semantic analysis is done. The parse
+// tree is owned by the parser, which allocates every node separately but
+// frees them all at once when it is destroyed.
+//
+// With the fast lexer, `lexer` reads nothing; it only keeps the string table
+// and the token values, which semantic analysis looks string constants up in.
+// The fast lexer reads the mapped bytes of `input` directly.
+struct FrontEnd {
+    MappedCharStream input;
+    CoolLexer lexer;
+    unique_ptr<FastCoolLexer> fast_lexer;
+    CommonTokenStream token_stream;
+    CoolParser parser;
+
+    FrontEnd(const string &file_path, bool use_fast_lexer)
+        : input(file_path), lexer(&input),
+          fast_lexer(use_fast_lexer
+                         ? make_unique<FastCoolLexer>(input.get_bytes(),
+                                                      file_path, &lexer)
+                         : nullptr),
+          token_stream(fast_lexer ? static_cast<TokenSource *>(fast_lexer.get())
+                                  : &lexer),
+          parser(&token_stream) {}
+};
+
+// How many parses were started and how many of them had to be redone in LL
+// mode. Shared by all threads, like the DFA cache of CoolParser.
+struct ParseStats {
+    atomic<size_t> parses = 0;
+    atomic<size_t> fallbacks = 0;
+
+    void count(bool fell_back) {
+        ++parses;
+        if (fell_back) {
+            ++fallbacks;
+        }
+    }
+};
+
+static ParseStats parse_stats;
+
+static void print_parse_stats() {
+    cerr << "Parses: " << parse_stats.parses << ", LL fallbacks: "
+         << parse_stats.fallbacks << endl;
+}
+
+// Lexes and parses every program of the warm-up corpus the way a compilation
+// does, and throws the results away. The DFA caches that ANTLR builds while
+// predicting are shared by every CoolLexer and CoolParser in the process, so
+// afterwards even the first real file is lexed and parsed with warm caches.
+//
+// Loading a DFA snapshot made at build time would be cheaper still, but the
+// C++ runtime has no way to serialize its DFA, so the corpus itself is what
+// gets compiled into the binary. This only pays off in modes that compile
+// more than one file.
+static void warm_up() {
+    auto start = chrono::steady_clock::now();
+
+    auto corpus = get_warmup_corpus();
+    for (const auto &program : corpus) {
+        ANTLRInputStream input(program.text);
+        CoolLexer lexer(&input);
+        lexer.removeErrorListeners();
+        CommonTokenStream token_stream(&lexer);
+        CoolParser parser(&token_stream);
+        parser.removeErrorListeners();
+
+        bool fell_back;
+        parse_sll_then_ll(parser, fell_back, [&] { return parser.program(); });
     }
 
-    auto file_path = argv[1];
-    ifstream fin(file_path);
+    chrono::duration<double, milli> wall = chrono::steady_clock::now() - start;
+    cerr << "Warmed up on " << corpus.size() << " programs in " << fixed
+         << setprecision(1) << wall.count() << " ms" << endl;
+}
 
+// Runs the whole pipeline on one file and writes either the generated
+// assembly or the list of semantic errors to `out`. If `class_cache` is given,
+// the code of classes that have not changed since it was stored is reused.
+//
+// The front end, which holds the parse tree, is destroyed as soon as the typed
+// AST has been built; the parse tree is usually several times the size of the
+// typed AST. With `pipeline`, every typed body is also freed right after its
+// code is emitted, so that no two representations of the whole program are
+// alive at the same time.
+static void compile(const string &file_path, AsmWriter &out, PhaseTimer *timer,
+                    ClassCache *class_cache, bool pipeline, bool fast_lexer) {
     auto file_name = fs::path(file_path).filename().string();
 
-    ANTLRInputStream input(fin);
-    CoolLexer lexer(&input);
+    auto front_end = make_unique<FrontEnd>(file_path, fast_lexer);
 
     // Silence console error reporting.
-    // lexer.removeErrorListener(&ConsoleErrorListener::INSTANCE);
+    // front_end->lexer.removeErrorListener(&ConsoleErrorListener::INSTANCE);
 
-    CommonTokenStream tokenStream(&lexer);
+    if (timer != nullptr || class_cache != nullptr) {
+        PhaseScope phase(timer, "lex");
+        front_end->token_stream.fill();
+    }
 
-    CoolParser parser(&tokenStream);
+    // Semantics runs the parser itself, so a failed SLL parse means starting
+    // semantic analysis over with a fresh CoolSemantics.
+    optional<CoolSemantics> semantics;
 
-    CoolSemantics semantics(&lexer, &parser);
+    // The parse is timed from inside semantics and reported as its own phase.
+    ParseClock parse_clock;
+    if (timer != nullptr) {
+        front_end->parser.addParseListener(&parse_clock);
+    }
 
-    auto semantics_result = semantics.run();
+    auto semantics_result = [&] {
+        PhaseScope phase(timer, "semantics");
+        bool fell_back;
+        auto result = parse_sll_then_ll(front_end->parser, fell_back, [&] {
+            return semantics.emplace(&front_end->lexer, &front_end->parser)
+                .run();
+        });
+        parse_stats.count(fell_back);
+        return result;
+    }();
+
+    if (timer != nullptr) {
+        front_end->parser.removeParseListener(&parse_clock);
+        timer->split_off("parse", parse_clock.wall_ms, parse_clock.allocations);
+    }
 
     if (!semantics_result.has_value()) {
         auto errors = semantics_result.error();
-        cout << "Semantic check failed with " << errors.size()
-             << " errors:" << endl;
+        out << "Semantic check failed with " << errors.size() << " errors:\n";
         for (auto &error : errors) {
-            cout << error << endl;
+            out << error << '\n';
         }
-        return 0;
+        return;
     }
 
     auto class_table = std::move(semantics_result.value());
     CoolCodegen codegen(file_name, std::move(class_table));
 
-    codegen.generate(cout);
+    if (class_cache != nullptr) {
+        codegen.use_class_cache(class_cache,
+                                ClassCache::hash_class_sources(
+                                    front_end->token_stream.getTokens()));
+    }
+
+    {
+        PhaseScope phase(timer, "release front end");
+        semantics.reset();
+        front_end.reset();
+    }
+
+    if (pipeline) {
+        codegen.release_bodies_after_use(true);
+    }
+
+    codegen.generate(out, timer);
+}
+
+// Compiles `input_path` into the file at `output_path`. Returns a description
+// of what went wrong if the files could not be read or written.
+static optional<string> compile_to_file(const string &input_path,
+                                        const fs::path &output_path,
+                                        ClassCache *class_cache,
+                                        bool pipeline, bool fast_lexer) {
+    if (!fs::is_regular_file(input_path)) {
+        return "cannot read input file";
+    }
+
+    int fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return "cannot open output file " + output_path.string();
+    }
+
+    optional<string> error;
+    try {
+        AsmWriter out(fd);
+        compile(input_path, out, nullptr, class_cache, pipeline, fast_lexer);
+        out.flush();
+        if (!out.good()) {
+            error = "error writing " + output_path.string();
+        }
+    } catch (const exception &e) {
+        error = e.what();
+    }
+
+    close(fd);
+    return error;
+}
+
+static void print_cache_stats(const ClassCache &class_cache) {
+    cerr << "Class cache: " << class_cache.get_hits() << " hits, "
+         << class_cache.get_misses() << " misses" << endl;
+}
+
+// Compiles every input file into `<output dir>/<stem>.s`, spreading the files
+// over a pool of worker threads.
+static int run_batch(const Options &options, ClassCache *class_cache) {
+    error_code ec;
+    fs::create_directories(options.output_dir, ec);
+    if (ec) {
+        cerr << "Cannot create output directory " << options.output_dir
+             << ": " << ec.message() << endl;
+        return 1;
+    }
+
+    auto output_path_for = [&](const string &file_path) {
+        return options.output_dir /
+               fs::path(file_path).filename().replace_extension(".s");
+    };
+
+    atomic<size_t> failures = 0;
+    mutex cerr_mutex;
+
+    auto start = chrono::steady_clock::now();
+
+    size_t num_workers;
+    {
+        WorkStealingPool pool(options.jobs);
+        num_workers = pool.get_num_workers();
+
+        for (const auto &file_path : options.files) {
+            pool.submit([&] {
+                auto output_path = output_path_for(file_path);
+                if (auto error = compile_to_file(
+                        file_path, output_path, class_cache, options.pipeline,
+                        options.fast_lexer)) {
+                    ++failures;
+                    lock_guard lock(cerr_mutex);
+                    cerr << file_path << ": " << *error << endl;
+                }
+            });
+        }
+
+        pool.wait();
+    }
+
+    chrono::duration<double, milli> wall = chrono::steady_clock::now() - start;
+    cerr << "Compiled " << options.files.size() << " files on " << num_workers
+         << " threads in " << fixed << setprecision(1) << wall.count()
+         << " ms";
+    if (failures != 0) {
+        cerr << " (" << failures << " failed)";
+    }
+    cerr << ", peak RSS " << peak_rss_kb() << " KiB" << endl;
+
+    if (class_cache != nullptr) {
+        print_cache_stats(*class_cache);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Serves compile requests read from stdin, one per line:
+//
+//     <input file>[<TAB><output file>]
+//
+// Fields are separated by a single tab, so paths may contain spaces; they may
+// not contain tabs or newlines. The output file defaults to the input file with
+// a `.s` extension. Each request is answered with one line on stdout, either
+// `ok <milliseconds>` or `error <message>`; a request with an empty path or
+// more than two fields is answered with an error and not compiled. The ATN and
+// the DFA caches of CoolLexer and CoolParser are shared by all their instances
+// in the process and are warmed up before the first request is read.
+static int run_server(ClassCache *class_cache, bool pipeline,
+                      bool fast_lexer) {
+    size_t num_requests = 0;
+    double total_ms = 0;
+
+    string line;
+    while (getline(cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        auto tab = line.find('\t');
+        auto input_path = line.substr(0, tab);
+
+        string output_path;
+        if (tab == string::npos) {
+            output_path = fs::path(input_path).replace_extension(".s").string();
+        } else {
+            output_path = line.substr(tab + 1);
+        }
+
+        if (output_path.find('\t') != string::npos) {
+            cout << "error too many fields in request" << endl;
+            continue;
+        }
+        if (input_path.empty() || output_path.empty()) {
+            cout << "error empty path in request" << endl;
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+        auto error = compile_to_file(input_path, output_path, class_cache,
+                                     pipeline, fast_lexer);
+        chrono::duration<double, milli> wall =
+            chrono::steady_clock::now() - start;
+
+        if (error) {
+            cout << "error " << *error << endl;
+        } else {
+            cout << "ok " << fixed << setprecision(3) << wall.count() << endl;
+        }
+
+        ++num_requests;
+        total_ms += wall.count();
+    }
+
+    if (num_requests != 0) {
+        cerr << "Served " << num_requests << " requests, " << fixed
+             << setprecision(3) << total_ms / num_requests
+             << " ms on average, peak RSS " << peak_rss_kb() << " KiB"
+             << endl;
+    }
+    if (class_cache != nullptr) {
+        print_cache_stats(*class_cache);
+    }
+
+    return 0;
+}
+
+// Prints the value of a string constant or an invalid symbol the way the lexer
+// tests of the first coursework expect it.
+static void print_escaped(ostream &out, string_view text) {
+    for (char c : text) {
+        switch (c) {
+        case '\\': out << "\\\\"; break;
+        case '"': out << "\\\""; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        case '\b': out << "\\b"; break;
+        case '\f': out << "\\f"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "<0x%02x>", c);
+                out << buffer;
+            } else {
+                out << c;
+            }
+        }
+    }
+}
+
+static string_view token_name(size_t type) {
+    switch (type) {
+    case CoolLexer::SEMI: return "';'";
+    case CoolLexer::OCURLY: return "'{'";
+    case CoolLexer::CCURLY: return "'}'";
+    case CoolLexer::OPAREN: return "'('";
+    case CoolLexer::COMMA: return "','";
+    case CoolLexer::CPAREN: return "')'";
+    case CoolLexer::COLON: return "':'";
+    case CoolLexer::AT: return "'@'";
+    case CoolLexer::DOT: return "'.'";
+    case CoolLexer::PLUS: return "'+'";
+    case CoolLexer::MINUS: return "'-'";
+    case CoolLexer::STAR: return "'*'";
+    case CoolLexer::SLASH: return "'/'";
+    case CoolLexer::TILDE: return "'~'";
+    case CoolLexer::LT: return "'<'";
+    case CoolLexer::EQ: return "'='";
+    case CoolLexer::DARROW: return "DARROW";
+    case CoolLexer::ASSIGN: return "ASSIGN";
+    case CoolLexer::LE: return "LE";
+    case CoolLexer::CLASS: return "CLASS";
+    case CoolLexer::ELSE: return "ELSE";
+    case CoolLexer::FI: return "FI";
+    case CoolLexer::IF: return "IF";
+    case CoolLexer::IN: return "IN";
+    case CoolLexer::INHERITS: return "INHERITS";
+    case CoolLexer::ISVOID: return "ISVOID";
+    case CoolLexer::LET: return "LET";
+    case CoolLexer::LOOP: return "LOOP";
+    case CoolLexer::POOL: return "POOL";
+    case CoolLexer::THEN: return "THEN";
+    case CoolLexer::WHILE: return "WHILE";
+    case CoolLexer::CASE: return "CASE";
+    case CoolLexer::ESAC: return "ESAC";
+    case CoolLexer::NEW: return "NEW";
+    case CoolLexer::OF: return "OF";
+    case CoolLexer::NOT: return "NOT";
+    case CoolLexer::BOOL_CONST: return "BOOL_CONST";
+    case CoolLexer::INT_CONST: return "INT_CONST";
+    case CoolLexer::STR_CONST: return "STR_CONST";
+    case CoolLexer::OBJECTID: return "OBJECTID";
+    case CoolLexer::TYPEID: return "TYPEID";
+    case CoolLexer::ERROR: return "ERROR:";
+    default: return "<Invalid Token>";
+    }
+}
+
+static string_view error_message(CoolLexer::ErrorCode code) {
+    using enum CoolLexer::ErrorCode;
+    switch (code) {
+    case STR_CONTAINS_ESC_NULL: return "String contains escaped null character";
+    case STR_CONTAINS_NULL: return "String contains null character";
+    case STR_CONTAINS_NEW_LINE: return "String contains unescaped new line";
+    case STR_CONTAINS_EOF: return "Unterminated string at EOF";
+    case STR_TOO_LONG: return "String constant too long";
+    case COMMENT_CONTAINS_EOF: return "EOF in comment";
+    case UNMATCHED_COMMENT_END: return "Unmatched *)";
+    case INVALID_SYMBOL: return "Invalid symbol";
+    }
+    return "";
+}
+
+// Prints one line per token in the format of the lexer tests of the first
+// coursework, `#<line> <token> [<value>]`.
+static void dump_token(CoolLexer &lexer, const Token *token, ostream &out) {
+    auto type = token->getType();
+    out << '#' << token->getLine() << ' ' << token_name(type);
+
+    switch (type) {
+    case CoolLexer::BOOL_CONST:
+        out << (get_token_bool_value(lexer, token) ? " true" : " false");
+        break;
+    case CoolLexer::STR_CONST:
+        out << " \"";
+        print_escaped(out, get_token_csl_text(lexer, token));
+        out << '"';
+        break;
+    case CoolLexer::INT_CONST:
+    case CoolLexer::OBJECTID:
+    case CoolLexer::TYPEID:
+        out << ' ' << token->getText();
+        break;
+    case CoolLexer::ERROR: {
+        auto code = get_token_error_code(lexer, token);
+        out << ' ' << error_message(code);
+        if (code == CoolLexer::ErrorCode::INVALID_SYMBOL) {
+            out << " \"";
+            print_escaped(out, token->getText());
+            out << '"';
+        }
+        break;
+    }
+    }
+
+    out << '\n';
+}
+
+// Lexes `file_path` and prints its tokens, so that both lexers can be checked
+// against the lexer tests of the first coursework and against each other.
+static int dump_tokens(const string &file_path, bool fast_lexer) {
+    if (!fs::is_regular_file(file_path)) {
+        cerr << file_path << ": cannot read input file" << endl;
+        return 1;
+    }
+
+    auto front_end = make_unique<FrontEnd>(file_path, fast_lexer);
+    front_end->token_stream.fill();
+
+    for (auto *token : front_end->token_stream.getTokens()) {
+        if (token->getType() != Token::EOF) {
+            dump_token(front_end->lexer, token, cout);
+        }
+    }
+    cout.flush();
+
+    return 0;
+}
+
+int main(int argc, const char *argv[]) {
+    auto options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (options->dump_tokens) {
+        return dump_tokens(options->files.front(), options->fast_lexer);
+    }
+
+    optional<ClassCache> class_cache_storage;
+    ClassCache *class_cache = nullptr;
+    if (options->cache_dir) {
+        class_cache = &class_cache_storage.emplace(*options->cache_dir);
+    }
+
+    if (options->batch || options->server) {
+        warm_up();
+
+        int status = options->batch
+                         ? run_batch(*options, class_cache)
+                         : run_server(class_cache, options->pipeline,
+                                      options->fast_lexer);
+        if (options->parse_stats) {
+            print_parse_stats();
+        }
+        return status;
+    }
+
+    PhaseTimer phase_timer;
+    PhaseTimer *timer =
+        options->time_report == TimeReport::None ? nullptr : &phase_timer;
+
+    const auto &file_path = options->files.front();
+    if (!fs::is_regular_file(file_path)) {
+        cerr << file_path << ": cannot read input file" << endl;
+        return 1;
+    }
+
+    {
+        AsmWriter out(STDOUT_FILENO);
+        compile(file_path, out, timer, class_cache, options->pipeline,
+                options->fast_lexer);
+
+        PhaseScope phase(timer, "write");
+        out.flush();
+    }
+
+    auto file_name = fs::path(file_path).filename().string();
+    if (options->time_report == TimeReport::Text) {
+        phase_timer.print_text(cerr);
+    } else if (options->time_report == TimeReport::Json) {
+        phase_timer.print_json(cerr, file_name);
+    }
+    if (class_cache != nullptr && timer != nullptr) {
+        print_cache_stats(*class_cache);
+    }
+    if (options->parse_stats) {
+        print_parse_stats();
+    }
 
     return 0;
 }
@@ -0,0 +1,26 @@
+#include "lexer/CoolToken.h"
+
+using namespace std;
+using namespace antlr4;
+
+bool get_token_bool_value(CoolLexer &lexer, const Token *token) {
+    if (auto *cool_token = dynamic_cast<const CoolToken *>(token)) {
+        return cool_token->value == 1;
+    }
+    return lexer.get_bool_value(token->getStartIndex());
+}
+
+const string &get_token_csl_text(CoolLexer &lexer, const Token *token) {
+    if (auto *cool_token = dynamic_cast<const CoolToken *>(token)) {
+        return lexer.interned_strings[cool_token->value];
+    }
+    return lexer.get_csl_text(token->getStartIndex());
+}
+
+CoolLexer::ErrorCode get_token_error_code(CoolLexer &lexer,
+                                          const Token *token) {
+    if (auto *cool_token = dynamic_cast<const CoolToken *>(token)) {
+        return static_cast<CoolLexer::ErrorCode>(cool_token->value);
+    }
+    return lexer.get_error_code(token->getStartIndex());
+}
@@ -0,0 +1,511 @@
+#include "lexer/FastCoolLexer.h"
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace antlr4;
+
+using ErrorCode = CoolLexer::ErrorCode;
+
+namespace {
+
+enum CharClass : uint8_t {
+    WHITESPACE = 1 << 0,
+    IDENTIFIER = 1 << 1,
+    DIGIT = 1 << 2,
+    // ASCII characters that STR_ANY in CoolLexer.g4 adds to a string as they
+    // are: anything but NUL, newline, '"' and '\\'.
+    STRING_PLAIN = 1 << 3,
+};
+
+constexpr array<uint8_t, 256> CHAR_CLASSES = [] {
+    array<uint8_t, 256> classes{};
+
+    for (unsigned char c : {' ', '\f', '\v', '\t', '\r', '\n'}) {
+        classes[c] |= WHITESPACE;
+    }
+    for (int c = 0; c < 256; ++c) {
+        bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool digit = c >= '0' && c <= '9';
+        if (letter || digit || c == '_') {
+            classes[c] |= IDENTIFIER;
+        }
+        if (digit) {
+            classes[c] |= DIGIT;
+        }
+        if (c >= 0x01 && c <= 0x7f && c != '\n' && c != '"' && c != '\\') {
+            classes[c] |= STRING_PLAIN;
+        }
+    }
+
+    return classes;
+}();
+
+bool has_class(char c, CharClass char_class) {
+    return (CHAR_CLASSES[static_cast<unsigned char>(c)] & char_class) != 0;
+}
+
+bool is_continuation_byte(char c) {
+    return (static_cast<unsigned char>(c) & 0xc0) == 0x80;
+}
+
+// Length of the UTF-8 sequence that starts with `lead`, never past `end`.
+size_t code_point_length(const char *lead, const char *end) {
+    auto c = static_cast<unsigned char>(*lead);
+    size_t length = c < 0xc0 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+    return min(length, static_cast<size_t>(end - lead));
+}
+
+size_t count_code_points(const char *begin, const char *end) {
+    size_t count = 0;
+    for (const char *p = begin; p != end; ++p) {
+        count += !is_continuation_byte(*p);
+    }
+    return count;
+}
+
+// Returns the first '(' or '*' in [p, end), or `end`. These are the only
+// characters that can start a comment delimiter.
+const char *find_comment_delimiter(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i open = _mm_set1_epi8('(');
+    const __m128i star = _mm_set1_epi8('*');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, open),
+                                                  _mm_cmpeq_epi8(chunk, star)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p != end && *p != '(' && *p != '*') {
+        ++p;
+    }
+    return p;
+}
+
+struct Keyword {
+    string_view text;
+    size_t type;
+};
+
+// Keywords are case insensitive, so they are compared in lower case.
+constexpr Keyword KEYWORDS[] = {
+    {"class", CoolLexer::CLASS}, {"else", CoolLexer::ELSE},
+    {"fi", CoolLexer::FI},       {"if", CoolLexer::IF},
+    {"in", CoolLexer::IN},       {"inherits", CoolLexer::INHERITS},
+    {"isvoid", CoolLexer::ISVOID}, {"let", CoolLexer::LET},
+    {"loop", CoolLexer::LOOP},   {"pool", CoolLexer::POOL},
+    {"then", CoolLexer::THEN},   {"while", CoolLexer::WHILE},
+    {"case", CoolLexer::CASE},   {"esac", CoolLexer::ESAC},
+    {"new", CoolLexer::NEW},     {"of", CoolLexer::OF},
+    {"not", CoolLexer::NOT},
+};
+
+constexpr size_t MAX_KEYWORD_LENGTH = 8;
+
+} // namespace
+
+FastCoolLexer::FastCoolLexer(string_view source, string source_name,
+                             CoolLexer *lexer)
+    : source_(source), source_name_(std::move(source_name)),
+      lexer_(lexer), token_source_(this, nullptr) {
+    end_ = source_.data() + source_.size();
+    position_ = Position{source_.data(), 1, 0, 0};
+}
+
+void FastCoolLexer::advance_to(const char *target) {
+    for (const char *p = position_.cursor; p != target; ++p) {
+        if (is_continuation_byte(*p)) {
+            continue;
+        }
+        ++position_.index;
+        if (*p == '\n') {
+            ++position_.line;
+            position_.column = 0;
+        } else {
+            ++position_.column;
+        }
+    }
+    position_.cursor = target;
+}
+
+int FastCoolLexer::intern_string(const string &str) {
+    auto [it, inserted] = lexer_->istring_index.try_emplace(
+        str, lexer_->interned_strings.size());
+    if (inserted) {
+        lexer_->interned_strings.push_back(str);
+    }
+    return it->second;
+}
+
+unique_ptr<CoolToken> FastCoolLexer::make_token(size_t type,
+                                                const Position &start,
+                                                size_t stop_index,
+                                                string_view text, int value) {
+    auto token = make_unique<CoolToken>(token_source_, type,
+                                        Token::DEFAULT_CHANNEL, start.index,
+                                        stop_index);
+    token->setLine(start.line);
+    token->setCharPositionInLine(start.column);
+    token->setText(string(text));
+    token->value = value;
+
+    switch (type) {
+    case CoolLexer::BOOL_CONST:
+        lexer_->bool_values[start.index] = value == 1;
+        break;
+    case CoolLexer::STR_CONST:
+        lexer_->string_tokens[start.index] = value;
+        break;
+    case CoolLexer::ERROR:
+        lexer_->error_codes[start.index] = static_cast<ErrorCode>(value);
+        break;
+    }
+
+    return token;
+}
+
+unique_ptr<CoolToken> FastCoolLexer::make_error(const Position &start,
+                                                const char *stop,
+                                                ErrorCode code) {
+    size_t length = count_code_points(start.cursor, stop);
+    return make_token(CoolLexer::ERROR, start, start.index + length - 1,
+                      string_view(start.cursor, stop - start.cursor),
+                      static_cast<int>(code));
+}
+
+unique_ptr<Token> FastCoolLexer::nextToken() {
+    while (true) {
+        const char *p = position_.cursor;
+        if (p == end_) {
+            return make_token(Token::EOF, position_, position_.index - 1,
+                              "<EOF>");
+        }
+
+        char c = *p;
+        char next = p + 1 != end_ ? p[1] : '\0';
+
+        if (has_class(c, WHITESPACE)) {
+            while (p != end_ && has_class(*p, WHITESPACE)) {
+                ++p;
+            }
+            advance_to(p);
+            continue;
+        }
+
+        if (has_class(c, DIGIT)) {
+            return lex_integer();
+        }
+        if (has_class(c, IDENTIFIER) && c != '_') {
+            return lex_identifier();
+        }
+
+        if (c == '"') {
+            if (auto token = lex_string()) {
+                return token;
+            }
+            continue;
+        }
+        if (c == '(' && next == '*') {
+            if (auto token = skip_block_comment()) {
+                return token;
+            }
+            continue;
+        }
+        if (c == '-' && next == '-') {
+            auto newline = static_cast<const char *>(
+                memchr(p + 2, '\n', end_ - (p + 2)));
+            advance_to(newline != nullptr ? newline + 1 : end_);
+            continue;
+        }
+
+        size_t type = 0;
+        size_t length = 1;
+        switch (c) {
+        case ';': type = CoolLexer::SEMI; break;
+        case '{': type = CoolLexer::OCURLY; break;
+        case '}': type = CoolLexer::CCURLY; break;
+        case '(': type = CoolLexer::OPAREN; break;
+        case ',': type = CoolLexer::COMMA; break;
+        case ')': type = CoolLexer::CPAREN; break;
+        case ':': type = CoolLexer::COLON; break;
+        case '@': type = CoolLexer::AT; break;
+        case '.': type = CoolLexer::DOT; break;
+        case '+': type = CoolLexer::PLUS; break;
+        case '-': type = CoolLexer::MINUS; break;
+        case '/': type = CoolLexer::SLASH; break;
+        case '~': type = CoolLexer::TILDE; break;
+        case '*':
+            if (next == ')') {
+                auto token = make_error(position_, p + 2,
+                                        ErrorCode::UNMATCHED_COMMENT_END);
+                advance_to(p + 2);
+                return token;
+            }
+            type = CoolLexer::STAR;
+            break;
+        case '<':
+            if (next == '-' || next == '=') {
+                type = next == '-' ? CoolLexer::ASSIGN : CoolLexer::LE;
+                length = 2;
+            } else {
+                type = CoolLexer::LT;
+            }
+            break;
+        case '=':
+            if (next == '>') {
+                type = CoolLexer::DARROW;
+                length = 2;
+            } else {
+                type = CoolLexer::EQ;
+            }
+            break;
+        default: {
+            const char *stop = p + code_point_length(p, end_);
+            auto token = make_error(position_, stop, ErrorCode::INVALID_SYMBOL);
+            advance_to(stop);
+            return token;
+        }
+        }
+
+        auto token = make_token(type, position_, position_.index + length - 1,
+                                string_view(p, length));
+        advance_to(p + length);
+        return token;
+    }
+}
+
+unique_ptr<Token> FastCoolLexer::lex_identifier() {
+    const char *begin = position_.cursor;
+    const char *p = begin + 1;
+    while (p != end_ && has_class(*p, IDENTIFIER)) {
+        ++p;
+    }
+    string_view text(begin, p - begin);
+
+    size_t type = 'a' <= text[0] && text[0] <= 'z' ? CoolLexer::OBJECTID
+                                                   : CoolLexer::TYPEID;
+    int value = -1;
+
+    if (text.size() <= MAX_KEYWORD_LENGTH) {
+        char lower_buffer[MAX_KEYWORD_LENGTH];
+        for (size_t i = 0; i < text.size(); ++i) {
+            lower_buffer[i] = static_cast<char>(tolower(text[i]));
+        }
+        string_view lower(lower_buffer, text.size());
+
+        for (const auto &keyword : KEYWORDS) {
+            if (keyword.text == lower) {
+                type = keyword.type;
+                break;
+            }
+        }
+
+        // Unlike the keywords, true and false must start in lower case.
+        if (lower == "true" && text[0] == 't') {
+            type = CoolLexer::BOOL_CONST;
+            value = 1;
+        } else if (lower == "false" && text[0] == 'f') {
+            type = CoolLexer::BOOL_CONST;
+            value = 0;
+        }
+    }
+
+    auto token = make_token(type, position_, position_.index + text.size() - 1,
+                            text, value);
+    advance_to(p);
+    return token;
+}
+
+unique_ptr<Token> FastCoolLexer::lex_integer() {
+    const char *begin = position_.cursor;
+    const char *p = begin + 1;
+    while (p != end_ && has_class(*p, DIGIT)) {
+        ++p;
+    }
+
+    auto token = make_token(CoolLexer::INT_CONST, position_,
+                            position_.index + (p - begin) - 1,
+                            string_view(begin, p - begin));
+    advance_to(p);
+    return token;
+}
+
+// Scans a string literal starting at the opening quote. Follows the STR mode of
+// CoolLexer.g4 rule by rule; in particular a rule ending in EOF wins over one
+// that matches the same characters without it.
+unique_ptr<Token> FastCoolLexer::lex_string() {
+    const size_t max_length = lexer_->MAX_STR_CONST;
+    const Position start = position_;
+
+    string_buffer_.clear();
+
+    const char *p = start.cursor + 1;
+    while (p != end_) {
+        char c = *p;
+
+        if (has_class(c, STRING_PLAIN)) {
+            const char *run_end = p + 1;
+            while (run_end != end_ && has_class(*run_end, STRING_PLAIN)) {
+                ++run_end;
+            }
+
+            if (run_end == end_) {
+                // STR_ANY adds all but the last character, which STR_ERR
+                // reports on its own unless the string got too long first.
+                if (string_buffer_.size() + (run_end - p) - 1 > max_length) {
+                    return skip_string_rest(run_end, ErrorCode::STR_TOO_LONG);
+                }
+                advance_to(run_end - 1);
+                auto token =
+                    make_error(position_, end_, ErrorCode::STR_CONTAINS_EOF);
+                advance_to(end_);
+                return token;
+            }
+
+            if (string_buffer_.size() + (run_end - p) > max_length) {
+                return skip_string_rest(run_end, ErrorCode::STR_TOO_LONG);
+            }
+            string_buffer_.append(p, run_end);
+            p = run_end;
+            continue;
+        }
+
+        if (c == '"') {
+            advance_to(p);
+            int value = intern_string(string_buffer_);
+            auto token = make_token(
+                CoolLexer::STR_CONST, start, position_.index,
+                string_view(start.cursor, p + 1 - start.cursor), value);
+            token->setLine(position_.line);
+            token->setCharPositionInLine(position_.column);
+            advance_to(p + 1);
+            return token;
+        }
+
+        if (c == '\n') {
+            advance_to(p);
+            auto token =
+                make_error(position_, p + 1, ErrorCode::STR_CONTAINS_NEW_LINE);
+            advance_to(p + 1);
+            return token;
+        }
+
+        if (c == '\0') {
+            return skip_string_rest(p + 1, ErrorCode::STR_CONTAINS_NULL);
+        }
+
+        size_t length = code_point_length(p, end_);
+        char added = c;
+
+        if (c == '\\' && length < static_cast<size_t>(end_ - p)) {
+            const char *escaped = p + 1;
+            switch (*escaped) {
+            case 'n': added = '\n'; break;
+            case 'b': added = '\b'; break;
+            case 'f': added = '\f'; break;
+            case 't': added = '\t'; break;
+            case '\0':
+                return skip_string_rest(p + 2, ErrorCode::STR_CONTAINS_ESC_NULL);
+            default: added = *escaped; break;
+            }
+            length += code_point_length(escaped, end_);
+        } else if (p + length == end_) {
+            // STR_ERR: a lone backslash or a non-ASCII character right before
+            // EOF.
+            advance_to(p);
+            auto token =
+                make_error(position_, end_, ErrorCode::STR_CONTAINS_EOF);
+            advance_to(end_);
+            return token;
+        }
+
+        if (string_buffer_.size() == max_length) {
+            return skip_string_rest(p + length, ErrorCode::STR_TOO_LONG);
+        }
+        string_buffer_.push_back(added);
+        p += length;
+    }
+
+    // EOF right after an escape sequence matches no rule and isn't reported.
+    advance_to(end_);
+    return nullptr;
+}
+
+// The ESTR mode of CoolLexer.g4: skips the rest of a bad string and reports
+// `code` on the closing quote or on the newline that ends it.
+unique_ptr<Token> FastCoolLexer::skip_string_rest(const char *p,
+                                                  ErrorCode code) {
+    while (p != end_) {
+        if (*p == '"' || *p == '\n') {
+            advance_to(p);
+            auto token = make_error(position_, p + 1, code);
+            advance_to(p + 1);
+            return token;
+        }
+        if (*p == '\\' && p + 1 != end_ && p[1] == 'n') {
+            p += 2;
+        } else {
+            ++p;
+        }
+    }
+
+    advance_to(end_);
+    return nullptr;
+}
+
+// Skips a block comment starting at its opening "(*". Follows the COMM mode of
+// CoolLexer.g4: if the comment runs into EOF, the last character is reported,
+// unless it was part of a delimiter.
+unique_ptr<Token> FastCoolLexer::skip_block_comment() {
+    const char *p = position_.cursor + 2;
+    const char *last_delimiter_end = p;
+    size_t depth = 1;
+
+    while (true) {
+        p = find_comment_delimiter(p, end_);
+        if (end_ - p < 2) {
+            break;
+        }
+
+        if (p[0] == '(' && p[1] == '*') {
+            ++depth;
+        } else if (p[0] == '*' && p[1] == ')') {
+            --depth;
+        } else {
+            ++p;
+            continue;
+        }
+
+        p += 2;
+        last_delimiter_end = p;
+        if (depth == 0) {
+            advance_to(p);
+            return nullptr;
+        }
+    }
+
+    if (last_delimiter_end == end_) {
+        advance_to(end_);
+        return nullptr;
+    }
+
+    const char *last = end_ - 1;
+    while (last != last_delimiter_end && is_continuation_byte(*last)) {
+        --last;
+    }
+    advance_to(last);
+    auto token = make_error(position_, end_, ErrorCode::COMMENT_CONTAINS_EOF);
+    advance_to(end_);
+    return token;
+}
@@ -0,0 +1,19 @@
+#include "util/SymbolTable.h"
+
+using namespace std;
+
+Symbol SymbolTable::intern(string_view name) {
+    auto it = symbols_.find(name);
+    if (it != symbols_.end()) {
+        return it->second;
+    }
+
+    auto symbol = static_cast<Symbol>(names_.size());
+    const auto &stored = names_.emplace_back(name);
+    symbols_.emplace(stored, symbol);
+    return symbol;
+}
+
+string_view SymbolTable::get_name(Symbol symbol) const {
+    return names_[static_cast<size_t>(symbol)];
+}
@@ -0,0 +1,101 @@
+#include "util/WorkStealingPool.h"
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(size_t num_workers) {
+    if (num_workers == 0) {
+        num_workers = max(1u, thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < num_workers; ++i) {
+        queues_.push_back(make_unique<WorkerQueue>());
+    }
+
+    threads_.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        threads_.emplace_back([this, i] { run_worker(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard lock(state_mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    // Count the task before it becomes visible, so a worker that steals it
+    // straight away can never take the counters below zero.
+    {
+        lock_guard lock(state_mutex_);
+        ++queued_;
+        ++unfinished_;
+    }
+
+    auto &queue = *queues_[next_queue_++ % queues_.size()];
+    {
+        lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    work_available_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    unique_lock lock(state_mutex_);
+    all_done_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+optional<WorkStealingPool::Task> WorkStealingPool::take(size_t worker_index) {
+    optional<Task> task;
+
+    {
+        auto &own = *queues_[worker_index];
+        lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    for (size_t offset = 1; !task && offset < queues_.size(); ++offset) {
+        auto &victim = *queues_[(worker_index + offset) % queues_.size()];
+        lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (task) {
+        lock_guard lock(state_mutex_);
+        --queued_;
+    }
+    return task;
+}
+
+void WorkStealingPool::run_worker(size_t worker_index) {
+    while (true) {
+        if (auto task = take(worker_index)) {
+            (*task)();
+
+            lock_guard lock(state_mutex_);
+            if (--unfinished_ == 0) {
+                all_done_.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock lock(state_mutex_);
+        work_available_.wait(lock,
+                             [this] { return stopping_ || queued_ != 0; });
+        if (stopping_ && queued_ == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,224 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+script_dir="$(cd -- "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+project_root="$(cd -- "${script_dir}/.." && pwd)"
+tests_dir="${project_root}/tests/codegen"
+bin_dir="${project_root}/build"
+lib_dir="${project_root}/lib"
+temp_dir="${project_root}/temp"
+baseline_path="${script_dir}/runtime-baseline.txt"
+
+mkdir -p "${temp_dir}"
+
+# Runs the codegen tests under spike and counts, for each of them:
+#   instructions : instructions retired by the whole program
+#   allocations  : calls to Object.copy, through which every object is made
+#   code_bytes   : size of the .text section of the linked program
+# and compares the counts against ${baseline_path}.
+#
+# Args-
+#   -u           : write the counts to the baseline instead of comparing
+#   -p <percent> : allowed growth of any count before a test fails (default 1)
+#   input/prefix : optional test file path or prefix
+update=false
+threshold=1
+input=""
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -u)
+      update=true
+      ;;
+    -p)
+      if [ $# -lt 2 ]; then
+        echo "Usage: $0 [-u] [-p percent] [input|prefix]"
+        exit 1
+      fi
+      threshold="$2"
+      shift
+      ;;
+    -*)
+      echo "Error: unknown option '$1'"
+      echo "Usage: $0 [-u] [-p percent] [input|prefix]"
+      exit 1
+      ;;
+    *)
+      if [ -z "$input" ]; then
+        input="$1"
+      else
+        echo "Error: unexpected extra argument '$1'"
+        echo "Usage: $0 [-u] [-p percent] [input|prefix]"
+        exit 1
+      fi
+      ;;
+  esac
+  shift
+done
+
+if [ ! -f "${lib_dir}/cc-rv-rt.o" ] || [ ! -f "${lib_dir}/cc-rv-rt.ld" ]; then
+    echo "Error: Required runtime library (cc-rv-rt) not found; download from https://github.com/smanilov/coolc-riscv-runtime, build it, and put it in code/lib" >&2
+    exit 1
+fi
+
+if [ ! -f "${bin_dir}/codegen" ]; then
+    echo "Error: Code generator not found in ${bin_dir}/codegen; build it first and then test" >&2
+    exit 1
+fi
+
+# The heaviest programs go first, so a regression shows up quickly.
+first_tests=(096.dijkstra 097.dfs 099.cells 100.hairyscary)
+
+tests=()
+if [ -z "$input" ]; then
+    for name in "${first_tests[@]}"; do
+        tests+=("${tests_dir}/${name}.cl")
+    done
+    for cl_path in "${tests_dir}"/*.cl; do
+        name="$(basename "${cl_path}" .cl)"
+        if [[ ! " ${first_tests[*]} " =~ " ${name} " ]]; then
+            tests+=("${cl_path}")
+        fi
+    done
+elif [ -e "$input" ]; then
+    tests=("$input")
+else
+    tests=( "${tests_dir}/${input}"*.cl )
+    if [ ! -e "${tests[0]}" ]; then
+        echo "Error: '${input}' is not a valid file name or prefix"
+        echo "Usage: $0 [-u] [-p percent] [input|prefix]"
+        exit 1
+    fi
+fi
+
+declare -A base_instructions base_allocations base_code_bytes
+if [ -f "${baseline_path}" ]; then
+    while read -r name instructions allocations code_bytes; do
+        [[ -z "${name}" || "${name}" == \#* ]] && continue
+        base_instructions["${name}"]="${instructions}"
+        base_allocations["${name}"]="${allocations}"
+        base_code_bytes["${name}"]="${code_bytes}"
+    done < "${baseline_path}"
+fi
+
+results=()
+regressed_tests=0
+failed_tests=0
+
+# Prints "<percent change>" of $2 relative to $1 and fails if it is above the
+# threshold.
+check_growth() {
+    local old="$1"
+    local new="$2"
+
+    awk -v old="${old}" -v new="${new}" -v limit="${threshold}" 'BEGIN {
+        change = old == 0 ? (new == 0 ? 0 : 100) : (new - old) * 100 / old
+        printf "%+.2f%%", change
+        exit change > limit ? 1 : 0
+    }'
+}
+
+run_bench() {
+    local cl_path="$1"
+    local testname s_path bin_path in_path out_path sol_path
+    local copy_address counts instructions allocations code_bytes
+
+    testname="$(basename "${cl_path}" .cl)"
+    s_path="${temp_dir}/${testname}.s"
+    bin_path="${temp_dir}/${testname}"
+    in_path="${tests_dir}/${testname}.in"
+    out_path="${tests_dir}/${testname}.out"
+    sol_path="${temp_dir}/${testname}.sol"
+
+    if ! "${bin_dir}/codegen" "${cl_path}" > "${s_path}"; then
+        echo "Test ${testname} CODEGEN FAILED"
+        failed_tests=$((failed_tests + 1))
+        return
+    fi
+
+    if ! riscv64-unknown-elf-gcc -mabi=ilp32 -march=rv32imzicsr -nostdlib \
+        "${lib_dir}/cc-rv-rt.o" "${s_path}" -T "${lib_dir}/cc-rv-rt.ld" \
+        -o "${bin_path}"; then
+        echo "Test ${testname} COMPILATION FAILED"
+        failed_tests=$((failed_tests + 1))
+        return
+    fi
+
+    copy_address="$(riscv64-unknown-elf-nm "${bin_path}" | awk '$3 == "Object.copy" { print $1 }')"
+    code_bytes="$(riscv64-unknown-elf-size -A "${bin_path}" | awk '$1 == ".text" { print $2 }')"
+
+    if [ ! -f "${in_path}" ]; then
+        in_path=/dev/null
+    fi
+
+    # With -l spike logs every retired instruction to stderr as
+    #   core   0: 0x<pc> (0x<encoding>) <disassembly>
+    # (besides `>>>> <symbol>` markers), so counting lines counts instructions,
+    # and counting lines at the entry of Object.copy counts allocations. The
+    # exit status is ignored, since some tests abort on purpose.
+    counts="$( { timeout 300s spike -l --isa=RV32IMZICSR "${bin_path}" \
+        < "${in_path}" > "${sol_path}"; } 2>&1 |
+        awk -v copy="0x${copy_address}" '
+            $1 == "core" && $3 ~ /^0x/ {
+                ++instructions
+                if (tolower($3) == copy) ++allocations
+            }
+            END { print instructions + 0, allocations + 0 }')" || true
+    read -r instructions allocations <<< "${counts}"
+
+    if ! diff -q "${out_path}" "${sol_path}" > /dev/null; then
+        echo "Test ${testname} FAILED (wrong output)"
+        failed_tests=$((failed_tests + 1))
+        return
+    fi
+
+    results+=("${testname} ${instructions} ${allocations} ${code_bytes}")
+
+    if $update; then
+        printf "%-24s %14s %12s %10s\n" "${testname}" "${instructions}" \
+            "${allocations}" "${code_bytes}"
+        return
+    fi
+
+    if [ -z "${base_instructions[${testname}]:-}" ]; then
+        printf "%-24s %14s %12s %10s  (no baseline)\n" "${testname}" \
+            "${instructions}" "${allocations}" "${code_bytes}"
+        return
+    fi
+
+    local status="ok"
+    local instructions_change allocations_change code_bytes_change
+    instructions_change="$(check_growth "${base_instructions[${testname}]}" "${instructions}")" || status="REGRESSED"
+    allocations_change="$(check_growth "${base_allocations[${testname}]}" "${allocations}")" || status="REGRESSED"
+    code_bytes_change="$(check_growth "${base_code_bytes[${testname}]}" "${code_bytes}")" || status="REGRESSED"
+
+    printf "%-24s %14s (%8s) %12s (%8s) %10s (%8s)  %s\n" "${testname}" \
+        "${instructions}" "${instructions_change}" \
+        "${allocations}" "${allocations_change}" \
+        "${code_bytes}" "${code_bytes_change}" "${status}"
+
+    if [ "${status}" != "ok" ]; then
+        regressed_tests=$((regressed_tests + 1))
+    fi
+}
+
+printf "%-24s %14s %12s %10s\n" "test" "instructions" "allocations" "code bytes"
+for cl_path in "${tests[@]}"; do
+    run_bench "${cl_path}"
+done
+
+if $update; then
+    {
+        echo "# Generated by tools/bench-runtime.sh -u"
+        echo "# test instructions allocations code_bytes"
+        printf "%s\n" "${results[@]}" | sort
+    } > "${baseline_path}"
+    echo "Baseline written to ${baseline_path}"
+fi
+
+# === Print summary ===
+echo "${#results[@]} measured, ${regressed_tests} regressed by more than ${threshold}%, ${failed_tests} failed"
+
+if [ "${failed_tests}" -ne 0 ] || [ "${regressed_tests}" -ne 0 ]; then
+    exit 1
+fi
@@ -0,0 +1,55 @@
+# Generates the definition of `get_warmup_corpus` (see
+# include/util/WarmupCorpus.h) with the contents of every file in INPUTS, a
+# list separated by '|', and writes it to OUTPUT.
+#
+# Usage: cmake -DINPUTS=<files> -DOUTPUT=<file> -P embed-corpus.cmake
+
+string(REPLACE "|" ";" inputs "${INPUTS}")
+
+set(arrays "")
+set(entries "")
+set(index 0)
+
+foreach(input IN LISTS inputs)
+  file(READ "${input}" content HEX)
+  if(content STREQUAL "")
+    continue()
+  endif()
+
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," content "${content}")
+  get_filename_component(name "${input}" NAME)
+
+  string(APPEND arrays "static const unsigned char program_${index}[] = {${content}};\n")
+  string(APPEND entries "    {\"${name}\", as_text(program_${index})},\n")
+  math(EXPR index "${index} + 1")
+endforeach()
+
+if(index EQUAL 0)
+  set(definition "std::span<const WarmupProgram> get_warmup_corpus() { return {}; }\n")
+else()
+  set(definition "${arrays}
+template <size_t N>
+static std::string_view as_text(const unsigned char (&bytes)[N]) {
+    return {reinterpret_cast<const char *>(bytes), N};
+}
+
+static const WarmupProgram corpus[] = {
+${entries}};
+
+std::span<const WarmupProgram> get_warmup_corpus() { return corpus; }
+")
+endif()
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated by tools/embed-corpus.cmake; do not edit.
+
+#include \"util/WarmupCorpus.h\"
+
+#include <cstddef>
+
+${definition}")
+
+# Only touch OUTPUT when it changes, so that an unchanged corpus doesn't cause
+# a rebuild.
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")
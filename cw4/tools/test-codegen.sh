@@ -12,9 +12,11 @@ mkdir -p "${temp_dir}"
 
 # Args-
 #   -t           : trace (print source + generated assembly before running)
+#   -s           : compile all tests through one `codegen --server` process
 #   interact     : run interactively (no diff/timeout)
 #   input/prefix : optional test file path or prefix
 trace=false
+server=false
 interact=false
 input=""
 
@@ -23,12 +25,15 @@ for arg in "$@"; do
     -t)
       trace=true
       ;;
+    -s)
+      server=true
+      ;;
     interact)
       interact=true
       ;;
     -*)
       echo "Error: unknown option '$arg'"
-      echo "Usage: $0 [-t] [input|prefix] [interact]"
+      echo "Usage: $0 [-t] [-s] [input|prefix] [interact]"
       exit 1
       ;;
     *)
@@ -36,7 +41,7 @@ for arg in "$@"; do
         input="$arg"
       else
         echo "Error: unexpected extra argument '$arg'"
-        echo "Usage: $0 [-t] [input|prefix] [interact]"
+        echo "Usage: $0 [-t] [-s] [input|prefix] [interact]"
         exit 1
       fi
       ;;
@@ -53,6 +58,30 @@ if [ ! -f "${bin_dir}/codegen" ]; then
     exit 1
 fi
 
+if $server; then
+    if $trace; then
+        coproc CODEGEN { "${bin_dir}/codegen" --server 2>/dev/null; }
+    else
+        coproc CODEGEN { "${bin_dir}/codegen" --server; }
+    fi
+fi
+
+# Compiles $1 into $2, either directly or through the codegen server.
+run_codegen() {
+    local cl_path="$1"
+    local s_path="$2"
+    local reply
+
+    if ! $server; then
+        "${bin_dir}/codegen" "${cl_path}" > "${s_path}"
+        return
+    fi
+
+    printf '%s\t%s\n' "${cl_path}" "${s_path}" >&"${CODEGEN[1]}"
+    read -r reply <&"${CODEGEN[0]}" || return 1
+    [[ "${reply}" == ok* ]]
+}
+
 run_test() {
     local input="$1"
     local testfile
@@ -81,12 +110,12 @@ run_test() {
 
     # Run codegen (optionally suppress its stderr when -t is enabled)
     if $trace; then
-        "${bin_dir}/codegen" "${cl_path}" > "${s_path}" 2>/dev/null || {
+        run_codegen "${cl_path}" "${s_path}" 2>/dev/null || {
             echo "Test ${testname} CODEGEN FAILED (stderr suppressed due to -t)"
             return
         }
     else
-        "${bin_dir}/codegen" "${cl_path}" > "${s_path}" || {
+        run_codegen "${cl_path}" "${s_path}" || {
             echo "Test ${testname} CODEGEN FAILED"
             return
         }
@@ -162,7 +191,7 @@ else
             done
         else
             echo "Error: '${input}' is not a valid file name or prefix"
-            echo "Usage: $0 [-t] [input|prefix] [interact]"
+            echo "Usage: $0 [-t] [-s] [input|prefix] [interact]"
             exit 1
         fi
     fi
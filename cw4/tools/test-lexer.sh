@@ -0,0 +1,82 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+script_dir="$(cd -- "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+project_root="$(cd -- "${script_dir}/.." && pwd)"
+tests_dir="${project_root}/../cw1/tests/lexer"
+bin_dir="${project_root}/build"
+temp_dir="${project_root}/temp"
+
+mkdir -p "${temp_dir}"
+
+# Checks that `codegen --fast-lexer` makes exactly the same tokens as the
+# ANTLR lexer, using the lexer tests of the first coursework as input. A test
+# FAILS if the two lexers disagree; the expected output of the first
+# coursework is compared too, but a mismatch there is only reported, since
+# this lexer follows the grammar in src/CoolLexer.g4.
+#
+# Args-
+#   input/prefix : optional test file path or prefix
+input="${1:-}"
+
+if [ ! -f "${bin_dir}/codegen" ]; then
+    echo "Error: Code generator not found in ${bin_dir}/codegen; build it first and then test" >&2
+    exit 1
+fi
+
+run_test() {
+    local in_path="$1"
+    local testname antlr_path fast_path out_path diff_output
+
+    testname="$(basename "${in_path}" .in)"
+    antlr_path="${temp_dir}/${testname}.antlr.tokens"
+    fast_path="${temp_dir}/${testname}.fast.tokens"
+    out_path="${tests_dir}/${testname}.out"
+
+    total_tests=$((total_tests + 1))
+
+    "${bin_dir}/codegen" --dump-tokens "${in_path}" > "${antlr_path}"
+    "${bin_dir}/codegen" --fast-lexer --dump-tokens "${in_path}" > "${fast_path}"
+
+    if ! diff_output=$(diff "${antlr_path}" "${fast_path}"); then
+        echo "Test ${testname} FAILED"
+        echo "diff between the ANTLR and the fast lexer is:"
+        echo "${diff_output}"
+        return
+    fi
+
+    passed_tests=$((passed_tests + 1))
+    if diff -q "${out_path}" "${fast_path}" > /dev/null; then
+        echo "Test ${testname} PASSED"
+    else
+        echo "Test ${testname} PASSED (differs from ${testname}.out)"
+    fi
+}
+
+# === Test counters ===
+total_tests=0
+passed_tests=0
+
+if [ -z "$input" ]; then
+    for in_path in "${tests_dir}"/*.in; do
+        run_test "${in_path}"
+    done
+elif [ -e "$input" ]; then
+    run_test "$input"
+else
+    matches=( "${tests_dir}/${input}"*.in )
+
+    if [ -e "${matches[0]}" ]; then
+        for in_path in "${matches[@]}"; do
+            run_test "${in_path}"
+        done
+    else
+        echo "Error: '${input}' is not a valid file name or prefix"
+        echo "Usage: $0 [input|prefix]"
+        exit 1
+    fi
+fi
+
+# === Print summary ===
+echo
+echo "Total ${passed_tests} out of ${total_tests} tests PASSED"
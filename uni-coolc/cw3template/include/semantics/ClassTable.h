@@ -0,0 +1,176 @@
+#ifndef SEMANTICS_CLASS_TABLE_H_
+#define SEMANTICS_CLASS_TABLE_H_
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+constexpr int SELF_TYPE_INDEX = -2;
+constexpr int NO_TYPE_INDEX = -1;
+
+// The built-in classes are added first, so their indices are fixed.
+constexpr int OBJECT_INDEX = 0;
+constexpr int IO_INDEX = 1;
+constexpr int INT_INDEX = 2;
+constexpr int STRING_INDEX = 3;
+constexpr int BOOL_INDEX = 4;
+
+// The type of expressions that failed to type check. Error messages print it
+// as `__ERROR`.
+constexpr int ERROR_TYPE_INDEX = 5;
+
+// The type of an assignment to an undefined name whose value has no type.
+// Error messages print it as `any`.
+constexpr int ANY_TYPE_INDEX = 6;
+
+// The classes, methods and attributes collected by the earlier passes, with
+// everything indexed by dense integers so that the type checker never looks a
+// name up once the table is built.
+//
+// Every type name gets an index, whether or not it names a class: the
+// built-in classes, the classes of the program, and names such as undefined
+// parents or the declared types of variables, which error messages still
+// print. SELF_TYPE is always SELF_TYPE_INDEX. No earlier pass rejects a class
+// named SELF_TYPE, so its parent and members are kept in a slot of their own.
+//
+// Method and attribute names get indices of their own. After
+// `build_lookup_tables`, each type has all the methods and attributes it
+// provides, inherited ones included, in arrays sorted by those indices.
+class ClassTable {
+  public:
+    struct MethodInfo {
+        // The nearest class in the ancestry that defines the method.
+        int defined_in;
+        int return_type;
+        std::vector<int> parameter_types;
+    };
+
+  private:
+    struct MethodSlot {
+        int name;
+        MethodInfo info;
+    };
+
+    struct AttributeSlot {
+        int name;
+        int type;
+    };
+
+    // Lets the name maps be searched with a string_view, without building a
+    // string for every lookup.
+    struct NameHash {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    using NameMap =
+        std::unordered_map<std::string, int, NameHash, std::equal_to<>>;
+
+    std::vector<std::string> type_names_;
+    NameMap type_name_to_index_;
+    std::vector<int> parents_;
+    std::vector<bool> is_class_;
+
+    std::vector<std::string> member_names_;
+    NameMap member_name_to_index_;
+
+    // Indexed by type; only what each type defines itself until
+    // `build_lookup_tables` adds the inherited members.
+    std::vector<std::vector<MethodSlot>> methods_;
+    std::vector<std::vector<AttributeSlot>> attributes_;
+
+    // Where SELF_TYPE_INDEX keeps its parent and members.
+    int self_type_slot_;
+
+    // Indexed by slot and filled in by `build_lookup_tables`. The types are
+    // numbered in preorder over the inheritance forest, so the subtypes of a
+    // type are numbered from its own number up to its `subtree_end_`. Types on
+    // or below an inheritance loop are not reached from any root and keep -1.
+    std::vector<int> preorder_;
+    std::vector<int> subtree_end_;
+    std::vector<int> roots_;
+
+    // An Euler tour of the forest, for lowest common ancestor queries.
+    std::vector<int> euler_slots_;
+    std::vector<int> euler_depths_;
+    std::vector<int> first_visit_;
+    std::vector<std::vector<int>> sparse_table_;
+
+    void index_hierarchy();
+    int walk_least_upper_bound(int type_a, int type_b) const;
+
+    int add_slot(std::string_view name);
+    int add_member_name(std::string_view name);
+
+    int slot(int type_index) const {
+        return type_index == SELF_TYPE_INDEX ? self_type_slot_ : type_index;
+    }
+
+  public:
+    ClassTable();
+
+    // Returns the index of `name`, adding it if it is new.
+    int add_type(std::string_view name);
+
+    // Marks `name` as a class of the program that inherits from `parent_name`.
+    void add_class(std::string_view name, std::string_view parent_name);
+
+    // A second definition with the same name replaces the first one.
+    void add_method(std::string_view class_name, std::string_view method_name,
+                    std::string_view return_type,
+                    const std::vector<std::string> &parameter_types);
+
+    // A second definition with the same name replaces the first one.
+    void add_attribute(std::string_view class_name,
+                       std::string_view attribute_name,
+                       std::string_view attribute_type);
+
+    // Resolves inheritance once all classes and members are added. The
+    // nearest definition in the ancestry of a type wins. Also indexes the
+    // hierarchy for `is_subclass_of` and `least_upper_bound`.
+    void build_lookup_tables();
+
+    // Returns NO_TYPE_INDEX if the name was never added.
+    int get_index(std::string_view name) const;
+
+    const std::string &get_name(int type_index) const;
+
+    // NO_TYPE_INDEX for the built-in classes and names that aren't classes.
+    int get_parent_index(int type_index) const;
+
+    // Whether the type is a class of the program, as opposed to a built-in
+    // class or an undefined name.
+    bool is_class(int type_index) const;
+
+    int size() const { return type_names_.size(); }
+
+    // Returns -1 if no class has a member with this name.
+    int get_member_index(std::string_view name) const;
+
+    // Returns nullptr if neither the type nor any of its ancestors has a
+    // method with this name.
+    const MethodInfo *find_method(int type_index, int method_index) const;
+
+    // If this method returns nullopt, then neither the type nor any of its
+    // ancestors has an attribute with this name.
+    std::optional<int> find_attribute(int type_index,
+                                      int attribute_index) const;
+
+    // Whether `ancestor_index` is the type or one of its ancestors, following
+    // parents as far as they are known. Constant time, unless the type is on
+    // or below an inheritance loop.
+    bool is_subclass_of(int type_index, int ancestor_index) const;
+
+    // The nearest ancestor the two types share, or NO_TYPE_INDEX if there is
+    // none. Constant time, unless a type is on or below an inheritance loop.
+    int least_upper_bound(int type_a, int type_b) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef SEMANTICS_COOL_SEMANTICS_H_
 #define SEMANTICS_COOL_SEMANTICS_H_
 
+#include <cstddef>
 #include <expected>
 #include <memory>
 #include <string>
@@ -14,16 +15,26 @@ class CoolSemantics
 private:
   CoolLexer *lexer_;
   CoolParser *parser_;
+  size_t check_jobs_ = 1;
 
 public:
   CoolSemantics(CoolLexer *lexer, CoolParser *parser)
       : lexer_(lexer), parser_(parser) {}
 
+  // How many workers type check the classes; zero means one per hardware
+  // thread. The errors are the same either way.
+  void set_check_jobs(size_t jobs) { check_jobs_ = jobs; }
+
   // Runs semantic analysis and returns the typed AST generated in the
   // process.
   //
   // In case of errors, a list of error messages is returned.
   std::expected<void *, std::vector<std::string>> run();
+
+  // Same as `run`, but on a program that has already been parsed, for
+  // example one whose classes were parsed separately.
+  std::expected<void *, std::vector<std::string>>
+  run(CoolParser::ProgramContext *program);
 };
 
 #endif
@@ -1,71 +1,71 @@
 #ifndef SEMANTICS_PASSES_TYPE_CHECKER_H_
 #define SEMANTICS_PASSES_TYPE_CHECKER_H_
 
-#include <any>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 
+#include "ClassTable.h"
 #include "CoolParser.h"
-#include "CoolParserBaseVisitor.h"
 
 using namespace std;
 
-class TypeChecker : public CoolParserBaseVisitor
+// Every type is an index into the class table. An expression whose value has
+// no type, such as a block, is NO_TYPE_INDEX; most callers treat that as
+// ERROR_TYPE_INDEX.
+class TypeChecker
 {
 private:
   // define any necessary fields
   std::vector<std::string> errors;
 
-  // override necessary visitor methods
+  const ClassTable &classTable;
+  size_t jobs;
 
   // define helper methods
   std::string current_class;
+  int current_class_index = NO_TYPE_INDEX;
   std::string current_method;
   std::unordered_set<std::string> visitedMethods;
-  unordered_map<string, unordered_map<string, vector<string>>> methodParamTypes;
-  unordered_map<string, unordered_map<string, string>> methodReturnTypes;
-  std::unordered_map<std::string, string> attrTypes;
-  std::unordered_map<std::string, unordered_map<string, string>> attrTypesByClass;
+  std::unordered_map<std::string, int> attrTypes;
 
-  unordered_map<string, CoolParser::ClassContext *> classes;
-  unordered_map<string, string> parent;
-  vector<string> classesInOrder;
+  void checkClass(CoolParser::ClassContext *ctx);
+  void checkMethod(CoolParser::MethodContext *ctx);
+  void checkAttr(CoolParser::AttrContext *ctx);
+  int checkExpr(CoolParser::ExprContext *ctx);
 
   void collectAttributes(CoolParser::ClassContext *ctx);
 
-  vector<unordered_map<string, string>> scopes;
+  vector<unordered_map<string, int>> scopes;
   void pushScope();
   void popScope();
-  bool lookVarInAllScopes(string &name, string &out);
-  bool lookupAttribute(string &name, string &out);
+  bool lookVarInAllScopes(const string &name, int &out);
+  bool lookupAttribute(const string &name, int &out);
 
-public:
-  // TODO: add necessary dependencies to constructor
-  TypeChecker(
-      unordered_map<string, CoolParser::ClassContext *> &classes,
-      unordered_map<string, string> &parent,
-      vector<string> &classesInOrder, std::unordered_map<std::string, unordered_map<string, string>> &attrTypesByClass,
-      unordered_map<string, unordered_map<string, vector<string>>> &methodParamTypes,
-      unordered_map<string, unordered_map<string, string>> &methodReturnTypes)
-  {
-    this->classes = classes;
-    this->parent = parent;
-    this->classesInOrder = classesInOrder;
-    this->attrTypesByClass = attrTypesByClass;
-    this->methodParamTypes = methodParamTypes;
-    this->methodReturnTypes = methodReturnTypes;
-  }
+  int typeOf(string_view name) const { return classTable.get_index(name); }
+  const string &nameOf(int type) const { return classTable.get_name(type); }
+
+  bool isClass(int type) const { return classTable.is_class(type); }
+  bool isSubtype(int type, int ancestor) const;
+  // Whether `type` is `of`, `Object`, `SELF_TYPE` or one of the classes `of`
+  // inherits from.
+  bool isSelfOrAncestor(int type, int of) const;
+  // Returns `none` if `a` and `b` have no common ancestor.
+  int leastUpperBound(int a, int b, int none) const;
+  const ClassTable::MethodInfo *findMethod(int cls, string_view methodName) const;
 
-  // Typechecks the AST that the parser produces and returns a list of errors,
-  // if any.
-  std::vector<std::string> check(CoolParser *parser);
+public:
+  // `classTable` has every type name in the program, so the checker only
+  // reads it. With `jobs` other than 1, the classes are checked on a pool of
+  // that many workers, zero meaning one per hardware thread.
+  explicit TypeChecker(const ClassTable &classTable, size_t jobs = 1)
+      : classTable(classTable), jobs(jobs) {}
 
-  std::any visitClass(CoolParser::ClassContext *ctx) override;
-  std::any visitMethod(CoolParser::MethodContext *ctx) override;
-  std::any visitExpr(CoolParser::ExprContext *ctx) override;
-  std::any visitAttr(CoolParser::AttrContext *ctx) override;
+  // Typechecks `program`, the tree the other passes ran over, and returns a
+  // list of errors, if any, in the same order however many jobs there are.
+  std::vector<std::string> check(CoolParser::ProgramContext *program);
 };
 
 #endif
@@ -1,6 +1,13 @@
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "antlr4-runtime/antlr4-runtime.h"
@@ -9,6 +16,8 @@
 #include "CoolParser.h"
 
 #include "semantics/CoolSemantics.h"
+#include "util/TwoStageParse.h"
+#include "util/WorkStealingPool.h"
 
 using namespace std;
 using namespace antlr4;
@@ -18,13 +27,193 @@ namespace fs = filesystem;
 
 constexpr bool debug = false;
 
+// Splits the visible tokens of a program into the ranges of its classes, each
+// from CLASS up to and including the closing brace, by matching braces.
+// Returns nothing unless the tokens have the shape
+// `(CLASS ... '{' ... '}' ';')+ EOF`; in that case the program has to be
+// parsed as a whole for the errors to be reported as usual.
+optional<vector<pair<size_t, size_t>>>
+split_classes(const vector<Token *> &tokens) {
+    vector<pair<size_t, size_t>> ranges;
+
+    size_t i = 0;
+    while (tokens[i]->getType() != Token::EOF) {
+        if (tokens[i]->getType() != CoolLexer::CLASS) {
+            return nullopt;
+        }
+        size_t start = i;
+
+        for (; tokens[i]->getType() != CoolLexer::OCURLY; ++i) {
+            auto type = tokens[i]->getType();
+            if (type == Token::EOF || type == CoolLexer::SEMI ||
+                type == CoolLexer::CCURLY) {
+                return nullopt;
+            }
+        }
+
+        size_t depth = 0;
+        do {
+            auto type = tokens[i++]->getType();
+            if (type == CoolLexer::OCURLY) {
+                ++depth;
+            } else if (type == CoolLexer::CCURLY) {
+                --depth;
+            } else if (type == Token::EOF) {
+                return nullopt;
+            }
+        } while (depth > 0);
+
+        ranges.emplace_back(start, i);
+
+        if (tokens[i]->getType() != CoolLexer::SEMI) {
+            return nullopt;
+        }
+        ++i;
+    }
+
+    if (ranges.empty()) {
+        return nullopt;
+    }
+    return ranges;
+}
+
+// One class parsed on its own, from copies of its tokens.
+struct ClassParse {
+    ListTokenSource token_source;
+    CommonTokenStream token_stream;
+    CoolParser parser;
+    CoolParser::ClassContext *tree = nullptr;
+
+    explicit ClassParse(vector<unique_ptr<Token>> tokens)
+        : token_source(std::move(tokens)), token_stream(&token_source),
+          parser(&token_stream) {}
+};
+
+// A program whose classes were parsed separately. The class trees belong to
+// their parsers, so `program` is only valid as long as this is alive.
+struct ParallelParse {
+    vector<unique_ptr<ClassParse>> classes;
+    CoolParser::ProgramContext program{nullptr, 0};
+};
+
+// Parses every class of the lexed program in `token_stream` with its own
+// CoolParser, on cw4's WorkStealingPool with a worker per core (the same pool
+// the type checker runs on), and puts the class trees
+// under a single ProgramContext. CoolParser instances share their DFA cache,
+// so the threads help each other warm it up.
+//
+// Each class is parsed with SLL prediction and BailErrorStrategy. Returns
+// null if the program can't be split into classes or any class fails to
+// parse; the whole program then has to be parsed the usual way, which also
+// reports the errors.
+unique_ptr<ParallelParse> parse_classes_in_parallel(
+    CommonTokenStream &token_stream) {
+    token_stream.fill();
+
+    vector<Token *> tokens;
+    for (auto *token : token_stream.getTokens()) {
+        if (token->getChannel() == Token::DEFAULT_CHANNEL) {
+            tokens.push_back(token);
+        }
+    }
+
+    auto ranges = split_classes(tokens);
+    if (!ranges) {
+        return nullptr;
+    }
+
+    auto result = make_unique<ParallelParse>();
+    result->classes.resize(ranges->size());
+
+    atomic<bool> failed = false;
+
+    auto parse_class = [&](size_t index) {
+        if (failed) {
+            return;
+        }
+        auto [start, end] = (*ranges)[index];
+
+        vector<unique_ptr<Token>> class_tokens;
+        class_tokens.reserve(end - start);
+        // The copies keep the start index of the originals, which is what the
+        // lexer's token values are keyed by.
+        for (size_t i = start; i < end; ++i) {
+            class_tokens.push_back(make_unique<CommonToken>(tokens[i]));
+        }
+
+        auto &class_parse = result->classes[index];
+        class_parse = make_unique<ClassParse>(std::move(class_tokens));
+
+        auto &parser = class_parse->parser;
+        parser.getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(
+            atn::PredictionMode::SLL);
+        parser.setErrorHandler(make_shared<BailErrorStrategy>());
+        parser.removeErrorListeners();
+
+        try {
+            class_parse->tree = parser.class_();
+            if (class_parse->token_stream.LA(1) != Token::EOF) {
+                failed = true;
+            }
+        } catch (const ParseCancellationException &) {
+            failed = true;
+        }
+    };
+
+    size_t num_workers =
+        min<size_t>(max(thread::hardware_concurrency(), 1u), ranges->size());
+    {
+        WorkStealingPool pool(num_workers);
+        for (size_t i = 0; i < ranges->size(); ++i) {
+            pool.submit([&parse_class, i] { parse_class(i); });
+        }
+        pool.wait();
+    }
+
+    if (failed) {
+        return nullptr;
+    }
+
+    auto &program = result->program;
+    for (auto &class_parse : result->classes) {
+        program.children.push_back(class_parse->tree);
+        class_parse->tree->parent = &program;
+    }
+    program.start = tokens.front();
+    program.stop = tokens[ranges->back().second];
+
+    return result;
+}
+
 int main(int argc, const char *argv[]) {
-    if (argc != 2) {
+    // With --parallel-parse, the classes are parsed in parallel; with
+    // --parallel-check, they are type checked in parallel; with
+    // --parse-stats, how the program was parsed is printed to stderr.
+    bool parallel_parse = false;
+    bool parallel_check = false;
+    bool parse_stats = false;
+    const char *file_path = nullptr;
+    bool bad_arguments = false;
+    for (int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+        if (arg == "--parallel-parse") {
+            parallel_parse = true;
+        } else if (arg == "--parallel-check") {
+            parallel_check = true;
+        } else if (arg == "--parse-stats") {
+            parse_stats = true;
+        } else if (file_path == nullptr && !arg.starts_with("--")) {
+            file_path = argv[i];
+        } else {
+            bad_arguments = true;
+        }
+    }
+
+    if (bad_arguments || file_path == nullptr) {
         cerr << "Expecting exactly one argument: name of input file" << endl;
         return 1;
     }
 
-    auto file_path = argv[1];
     ifstream fin(file_path);
 
     auto file_name = fs::path(file_path).filename().string();
@@ -39,9 +228,32 @@ int main(int argc, const char *argv[]) {
 
     CoolParser parser(&tokenStream);
 
-    CoolSemantics semantics(&lexer, &parser);
+    unique_ptr<ParallelParse> parallel_result;
+    if (parallel_parse) {
+        parallel_result = parse_classes_in_parallel(tokenStream);
+    }
 
-    auto run_result = semantics.run();
+    CoolParser::ProgramContext *program;
+    string_view parse_mode;
+    if (parallel_result) {
+        program = &parallel_result->program;
+        parse_mode = "parallel";
+    } else {
+        bool fell_back;
+        program = parse_sll_then_ll(parser, fell_back,
+                                    [&] { return parser.program(); });
+        parse_mode = fell_back ? "LL fallback" : "SLL";
+    }
+
+    if (parse_stats) {
+        cerr << file_name << ": " << parse_mode << endl;
+    }
+
+    CoolSemantics semantics(&lexer, &parser);
+    if (parallel_check) {
+        semantics.set_check_jobs(0);
+    }
+    auto run_result = semantics.run(program);
 
     if (!run_result.has_value()) {
         auto errors = run_result.error();
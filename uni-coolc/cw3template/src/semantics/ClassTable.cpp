@@ -0,0 +1,338 @@
+#include "ClassTable.h"
+
+#include <algorithm>
+#include <bit>
+#include <unordered_set>
+
+using namespace std;
+
+ClassTable::ClassTable() {
+    for (auto name : {"Object", "IO", "Int", "String", "Bool", "__ERROR",
+                      "any"}) {
+        add_type(name);
+    }
+    self_type_slot_ = add_slot("SELF_TYPE");
+}
+
+int ClassTable::add_type(string_view name) {
+    if (name == "SELF_TYPE") {
+        return SELF_TYPE_INDEX;
+    }
+    return add_slot(name);
+}
+
+int ClassTable::add_slot(string_view name) {
+    auto [it, inserted] =
+        type_name_to_index_.try_emplace(string(name), type_names_.size());
+    if (inserted) {
+        type_names_.emplace_back(name);
+        parents_.push_back(NO_TYPE_INDEX);
+        is_class_.push_back(false);
+        methods_.emplace_back();
+        attributes_.emplace_back();
+    }
+    return it->second;
+}
+
+int ClassTable::add_member_name(string_view name) {
+    auto [it, inserted] =
+        member_name_to_index_.try_emplace(string(name), member_names_.size());
+    if (inserted) {
+        member_names_.emplace_back(name);
+    }
+    return it->second;
+}
+
+void ClassTable::add_class(string_view name, string_view parent_name) {
+    int class_index = slot(add_type(name));
+    int parent_index = add_type(parent_name);
+    parents_[class_index] = parent_index;
+    is_class_[class_index] = true;
+}
+
+void ClassTable::add_method(string_view class_name, string_view method_name,
+                            string_view return_type,
+                            const vector<string> &parameter_types) {
+    int class_index = add_type(class_name);
+
+    MethodSlot entry{add_member_name(method_name),
+                     {class_index, add_type(return_type), {}}};
+    entry.info.parameter_types.reserve(parameter_types.size());
+    for (auto &type : parameter_types) {
+        entry.info.parameter_types.push_back(add_type(type));
+    }
+
+    auto &methods = methods_[slot(class_index)];
+    auto it = find_if(methods.begin(), methods.end(),
+                      [&](auto &method) { return method.name == entry.name; });
+    if (it != methods.end()) {
+        *it = std::move(entry);
+    } else {
+        methods.push_back(std::move(entry));
+    }
+}
+
+void ClassTable::add_attribute(string_view class_name,
+                               string_view attribute_name,
+                               string_view attribute_type) {
+    int class_index = slot(add_type(class_name));
+
+    AttributeSlot entry{add_member_name(attribute_name),
+                        add_type(attribute_type)};
+
+    auto &attributes = attributes_[class_index];
+    auto it = find_if(attributes.begin(), attributes.end(),
+                      [&](auto &attribute) { return attribute.name == entry.name; });
+    if (it != attributes.end()) {
+        *it = entry;
+    } else {
+        attributes.push_back(entry);
+    }
+}
+
+void ClassTable::build_lookup_tables() {
+    auto own_methods = std::move(methods_);
+    auto own_attributes = std::move(attributes_);
+    methods_.assign(size(), {});
+    attributes_.assign(size(), {});
+
+    // The step limit stops the walk on inheritance loops, which are reported
+    // by an earlier pass.
+    vector<int> method_seen(member_names_.size(), NO_TYPE_INDEX);
+    vector<int> attribute_seen(member_names_.size(), NO_TYPE_INDEX);
+    for (int type = 0; type < size(); ++type) {
+        int steps = 0;
+        for (int ancestor = type; ancestor != NO_TYPE_INDEX && steps <= size();
+             ancestor = slot(parents_[ancestor]), ++steps) {
+            for (auto &method : own_methods[ancestor]) {
+                if (method_seen[method.name] != type) {
+                    method_seen[method.name] = type;
+                    methods_[type].push_back(method);
+                }
+            }
+            for (auto &attribute : own_attributes[ancestor]) {
+                if (attribute_seen[attribute.name] != type) {
+                    attribute_seen[attribute.name] = type;
+                    attributes_[type].push_back(attribute);
+                }
+            }
+        }
+
+        sort(methods_[type].begin(), methods_[type].end(),
+             [](auto &a, auto &b) { return a.name < b.name; });
+        sort(attributes_[type].begin(), attributes_[type].end(),
+             [](auto &a, auto &b) { return a.name < b.name; });
+    }
+
+    index_hierarchy();
+}
+
+void ClassTable::index_hierarchy() {
+    vector<vector<int>> children(size());
+    for (int type = 0; type < size(); ++type) {
+        if (parents_[type] != NO_TYPE_INDEX) {
+            children[slot(parents_[type])].push_back(type);
+        }
+    }
+
+    preorder_.assign(size(), -1);
+    subtree_end_.assign(size(), -1);
+    roots_.assign(size(), -1);
+    first_visit_.assign(size(), -1);
+    euler_slots_.clear();
+    euler_depths_.clear();
+
+    // Depth-first with an explicit stack, since a long chain of classes would
+    // overflow the call stack. Each entry is a slot and how many of its
+    // children are done.
+    int next_number = 0;
+    vector<pair<int, size_t>> stack;
+    for (int root = 0; root < size(); ++root) {
+        if (parents_[root] != NO_TYPE_INDEX) {
+            continue;
+        }
+
+        auto enter = [&](int type) {
+            preorder_[type] = next_number++;
+            roots_[type] = root;
+            first_visit_[type] = euler_slots_.size();
+            euler_slots_.push_back(type);
+            euler_depths_.push_back(stack.size());
+        };
+
+        enter(root);
+        stack.push_back({root, 0});
+        while (!stack.empty()) {
+            auto [type, done] = stack.back();
+            if (done < children[type].size()) {
+                ++stack.back().second;
+                int child = children[type][done];
+                enter(child);
+                stack.push_back({child, 0});
+                continue;
+            }
+
+            subtree_end_[type] = next_number;
+            stack.pop_back();
+            if (!stack.empty()) {
+                euler_slots_.push_back(stack.back().first);
+                euler_depths_.push_back(stack.size() - 1);
+            }
+        }
+    }
+
+    // Row k holds, for each step of the tour, the step with the smallest depth
+    // among the 2^k steps starting there.
+    int steps = euler_slots_.size();
+    sparse_table_.assign(1, vector<int>(steps));
+    for (int i = 0; i < steps; ++i) {
+        sparse_table_[0][i] = i;
+    }
+    for (int k = 1; (1 << k) <= steps; ++k) {
+        auto &previous = sparse_table_[k - 1];
+        vector<int> row(steps - (1 << k) + 1);
+        for (int i = 0; i < (int)row.size(); ++i) {
+            int left = previous[i];
+            int right = previous[i + (1 << (k - 1))];
+            row[i] = euler_depths_[left] <= euler_depths_[right] ? left : right;
+        }
+        sparse_table_.push_back(std::move(row));
+    }
+}
+
+int ClassTable::get_index(string_view name) const {
+    if (name == "SELF_TYPE") {
+        return SELF_TYPE_INDEX;
+    }
+
+    auto it = type_name_to_index_.find(name);
+    return it == type_name_to_index_.end() ? NO_TYPE_INDEX : it->second;
+}
+
+const string &ClassTable::get_name(int type_index) const {
+    static const string self_type = "SELF_TYPE";
+    static const string no_type = "_no_type";
+    if (type_index == SELF_TYPE_INDEX) {
+        return self_type;
+    }
+    if (type_index == NO_TYPE_INDEX) {
+        return no_type;
+    }
+    return type_names_[type_index];
+}
+
+int ClassTable::get_parent_index(int type_index) const {
+    return type_index == NO_TYPE_INDEX ? NO_TYPE_INDEX
+                                       : parents_[slot(type_index)];
+}
+
+bool ClassTable::is_class(int type_index) const {
+    return type_index != NO_TYPE_INDEX && is_class_[slot(type_index)];
+}
+
+int ClassTable::get_member_index(string_view name) const {
+    auto it = member_name_to_index_.find(name);
+    return it == member_name_to_index_.end() ? -1 : it->second;
+}
+
+const ClassTable::MethodInfo *ClassTable::find_method(int type_index,
+                                                      int method_index) const {
+    if (type_index == NO_TYPE_INDEX || method_index < 0) {
+        return nullptr;
+    }
+
+    auto &methods = methods_[slot(type_index)];
+    auto it = lower_bound(
+        methods.begin(), methods.end(), method_index,
+        [](auto &method, int name) { return method.name < name; });
+    if (it == methods.end() || it->name != method_index) {
+        return nullptr;
+    }
+    return &it->info;
+}
+
+optional<int> ClassTable::find_attribute(int type_index,
+                                         int attribute_index) const {
+    if (type_index == NO_TYPE_INDEX || attribute_index < 0) {
+        return nullopt;
+    }
+
+    auto &attributes = attributes_[slot(type_index)];
+    auto it = lower_bound(
+        attributes.begin(), attributes.end(), attribute_index,
+        [](auto &attribute, int name) { return attribute.name < name; });
+    if (it == attributes.end() || it->name != attribute_index) {
+        return nullopt;
+    }
+    return it->type;
+}
+
+bool ClassTable::is_subclass_of(int type_index, int ancestor_index) const {
+    if (type_index == NO_TYPE_INDEX || ancestor_index == NO_TYPE_INDEX) {
+        return false;
+    }
+
+    int type = slot(type_index);
+    int ancestor = slot(ancestor_index);
+    if (preorder_[type] >= 0) {
+        return preorder_[ancestor] >= 0 &&
+               preorder_[ancestor] <= preorder_[type] &&
+               preorder_[type] < subtree_end_[ancestor];
+    }
+
+    // The type is on or below an inheritance loop.
+    int steps = 0;
+    for (int type = type_index; type != NO_TYPE_INDEX && steps <= size();
+         type = get_parent_index(type), ++steps) {
+        if (type == ancestor_index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ClassTable::least_upper_bound(int type_a, int type_b) const {
+    if (type_a == NO_TYPE_INDEX || type_b == NO_TYPE_INDEX) {
+        return NO_TYPE_INDEX;
+    }
+    if (type_a == type_b) {
+        return type_a;
+    }
+
+    int a = slot(type_a);
+    int b = slot(type_b);
+    if (preorder_[a] < 0 || preorder_[b] < 0) {
+        return walk_least_upper_bound(type_a, type_b);
+    }
+    if (roots_[a] != roots_[b]) {
+        return NO_TYPE_INDEX;
+    }
+
+    // The common ancestor is the shallowest slot the tour passes between the
+    // first visits of the two types.
+    int first = min(first_visit_[a], first_visit_[b]);
+    int last = max(first_visit_[a], first_visit_[b]);
+    int k = bit_width(unsigned(last - first + 1)) - 1;
+    int left = sparse_table_[k][first];
+    int right = sparse_table_[k][last - (1 << k) + 1];
+    int ancestor =
+        euler_slots_[euler_depths_[left] <= euler_depths_[right] ? left : right];
+    return ancestor == self_type_slot_ ? SELF_TYPE_INDEX : ancestor;
+}
+
+int ClassTable::walk_least_upper_bound(int type_a, int type_b) const {
+    unordered_set<int> ancestors;
+    for (int type = type_a; type != NO_TYPE_INDEX && !ancestors.count(type);
+         type = get_parent_index(type)) {
+        ancestors.insert(type);
+    }
+
+    int steps = 0;
+    for (int type = type_b; type != NO_TYPE_INDEX && steps <= size();
+         type = get_parent_index(type), ++steps) {
+        if (ancestors.count(type)) {
+            return type;
+        }
+    }
+    return NO_TYPE_INDEX;
+}
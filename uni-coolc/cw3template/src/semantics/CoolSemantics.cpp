@@ -7,6 +7,7 @@
 #include <unordered_set>
 #include <algorithm>
 
+#include "ClassTable.h"
 #include "passes/TypeChecker.h"
 
 using namespace std;
@@ -53,10 +54,22 @@ void detectAttrOverrideErrors(
     vector<string> &classesInOrder,
     vector<string> &errors);
 
+ClassTable buildClassTable(
+    CoolParser::ProgramContext *program,
+    unordered_map<string, string> &parent,
+    vector<string> &classesInOrder, std::unordered_map<std::string, unordered_map<string, string>> &attrTypesByClass,
+    unordered_map<string, unordered_map<string, vector<string>>> &methodParamTypes,
+    unordered_map<string, unordered_map<string, string>> &methodReturnTypes);
+
+expected<void *, vector<string>> CoolSemantics::run()
+{
+    return run(parser_->program());
+}
+
 // Runs semantic analysis and returns a list of errors, if any.
 //
 // TODO: change the type from void * to your typed AST type
-expected<void *, vector<string>> CoolSemantics::run()
+expected<void *, vector<string>> CoolSemantics::run(CoolParser::ProgramContext *program)
 {
     vector<string> errors;
 
@@ -68,7 +81,8 @@ expected<void *, vector<string>> CoolSemantics::run()
     unordered_map<string, unordered_map<string, vector<string>>> methodParamTypes;
     unordered_map<string, unordered_map<string, string>> methodReturnTypes;
 
-    auto *program = parser_->program();
+    // Every pass works on this one tree; the `ClassContext`s collected here
+    // are the ones the type checker visits.
     collectClasses(program, classes, parent, classesInOrder, errors, attrTypesByClass, methodParamTypes, methodReturnTypes);
 
     auto loops = detectInheritanceLoops(parent, classesInOrder);
@@ -91,8 +105,8 @@ expected<void *, vector<string>> CoolSemantics::run()
 
     detectAttrOverrideErrors(classes, parent, classesInOrder, errors);
 
-    parser_->reset();
-    for (const auto &error : TypeChecker(classes, parent, classesInOrder, attrTypesByClass, methodParamTypes, methodReturnTypes).check(parser_))
+    auto classTable = buildClassTable(program, parent, classesInOrder, attrTypesByClass, methodParamTypes, methodReturnTypes);
+    for (const auto &error : TypeChecker(classTable, check_jobs_).check(program))
     {
         errors.push_back(error);
     }
@@ -515,4 +529,70 @@ void detectAttrOverrideErrors(
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// class table
+
+// Adds the text of every TYPEID under `tree`, so that the type checker finds
+// an index for every type name it sees.
+void addTypeNames(antlr4::tree::ParseTree *tree, ClassTable &classTable)
+{
+    if (auto *terminal = dynamic_cast<antlr4::tree::TerminalNode *>(tree))
+    {
+        if (terminal->getSymbol()->getType() == CoolParser::TYPEID)
+        {
+            classTable.add_type(terminal->getText());
+        }
+        return;
+    }
+
+    for (auto *child : tree->children)
+    {
+        addTypeNames(child, classTable);
+    }
+}
+
+ClassTable buildClassTable(
+    CoolParser::ProgramContext *program,
+    unordered_map<string, string> &parent,
+    vector<string> &classesInOrder, std::unordered_map<std::string, unordered_map<string, string>> &attrTypesByClass,
+    unordered_map<string, unordered_map<string, vector<string>>> &methodParamTypes,
+    unordered_map<string, unordered_map<string, string>> &methodReturnTypes)
+{
+    ClassTable classTable;
+
+    for (const auto &clsName : classesInOrder)
+    {
+        classTable.add_class(clsName, parent.at(clsName));
+    }
+
+    for (const auto &[clsName, returnTypes] : methodReturnTypes)
+    {
+        for (const auto &[methodName, returnType] : returnTypes)
+        {
+            classTable.add_method(clsName, methodName, returnType, methodParamTypes.at(clsName).at(methodName));
+        }
+    }
+
+    for (const auto &[clsName, attrTypes] : attrTypesByClass)
+    {
+        for (const auto &[attrName, attrType] : attrTypes)
+        {
+            classTable.add_attribute(clsName, attrName, attrType);
+        }
+    }
+
+    classTable.add_method("String", "concat", "String", {"String"});
+    classTable.add_method("String", "length", "Int", {});
+    classTable.add_method("String", "substr", "String", {"Int", "Int"});
+
+    classTable.add_method("IO", "doh", "Int", {});
+    classTable.add_method("IO", "printh", "Int", {});
+
+    classTable.add_method("Object", "abort", "Object", {});
+
+    addTypeNames(program, classTable);
+
+    classTable.build_lookup_tables();
+    return classTable;
+}
@@ -4,44 +4,74 @@
 #include <vector>
 
 #include "CoolParser.h"
+#include "util/WorkStealingPool.h"
 
 using namespace std;
 
-vector<string> TypeChecker::check(CoolParser *parser)
+vector<string> TypeChecker::check(CoolParser::ProgramContext *program)
 {
+    auto classes = program->class_();
+    if (jobs == 1 || classes.size() < 2)
+    {
+        for (auto *cls : classes)
+        {
+            checkClass(cls);
+        }
 
-    methodReturnTypes["String"]["concat"] = "String";
-    methodParamTypes["String"]["concat"] = {"String"};
-    methodReturnTypes["String"]["length"] = "Int";
-    methodParamTypes["String"]["length"] = {};
-    methodReturnTypes["String"]["substr"] = "String";
-    methodParamTypes["String"]["substr"] = {"Int", "Int"};
-
-    methodReturnTypes["IO"]["doh"] = "Int";
-    methodParamTypes["IO"]["doh"] = {};
-    methodReturnTypes["IO"]["printh"] = "Int";
-    methodParamTypes["IO"]["printh"] = {};
+        return std::move(errors);
+    }
 
-    methodReturnTypes["Object"]["abort"] = "Object";
-    methodParamTypes["Object"]["abort"] = {};
+    // The current class, scopes and errors belong to one class at a time, so
+    // every class gets a checker of its own; they all share the class table.
+    // Each class's errors are kept apart and joined in the order the classes
+    // are written.
+    vector<vector<string>> classErrors(classes.size());
+    {
+        WorkStealingPool pool(jobs);
+        for (size_t i = 0; i < classes.size(); ++i)
+        {
+            pool.submit([this, &classes, &classErrors, i]
+            {
+                TypeChecker checker(classTable);
+                checker.checkClass(classes[i]);
+                classErrors[i] = std::move(checker.errors);
+            });
+        }
+        pool.wait();
+    }
 
-    visitProgram(parser->program());
-    parser->reset();
+    for (auto &batch : classErrors)
+    {
+        for (auto &error : batch)
+        {
+            errors.push_back(std::move(error));
+        }
+    }
 
     return std::move(errors);
 }
 
-std::any TypeChecker::visitClass(CoolParser::ClassContext *ctx)
+void TypeChecker::checkClass(CoolParser::ClassContext *ctx)
 {
     current_class = ctx->TYPEID(0)->getText();
+    current_class_index = typeOf(current_class);
     visitedMethods.clear();
     pushScope();
     collectAttributes(ctx);
 
-    auto c = visitChildren(ctx);
+    // Methods and attributes in the order they are written.
+    for (auto *child : ctx->children)
+    {
+        if (auto *method = dynamic_cast<CoolParser::MethodContext *>(child))
+        {
+            checkMethod(method);
+        }
+        else if (auto *attr = dynamic_cast<CoolParser::AttrContext *>(child))
+        {
+            checkAttr(attr);
+        }
+    }
     popScope();
-
-    return c;
 }
 
 void TypeChecker::collectAttributes(CoolParser::ClassContext *ctx)
@@ -51,18 +81,18 @@ void TypeChecker::collectAttributes(CoolParser::ClassContext *ctx)
     for (auto *attr : ctx->attr())
     {
         string attrName = attr->OBJECTID()->getText();
-        string declaredType = attr->TYPEID()->getText();
-
-        if (declaredType != "Int" &&
-            declaredType != "Bool" &&
-            declaredType != "String" &&
-            declaredType != "Object" &&
-            declaredType != "SELF_TYPE" &&
-            !classes.count(declaredType))
+        int declaredType = typeOf(attr->TYPEID()->getText());
+
+        if (declaredType != INT_INDEX &&
+            declaredType != BOOL_INDEX &&
+            declaredType != STRING_INDEX &&
+            declaredType != OBJECT_INDEX &&
+            declaredType != SELF_TYPE_INDEX &&
+            !isClass(declaredType))
         {
             errors.push_back(
                 "Attribute `" + attrName + "` in class `" + current_class +
-                "` declared to have type `" + declaredType + "` which is undefined");
+                "` declared to have type `" + nameOf(declaredType) + "` which is undefined");
             continue;
         }
 
@@ -78,97 +108,62 @@ void TypeChecker::collectAttributes(CoolParser::ClassContext *ctx)
     }
 }
 
-std::any TypeChecker::visitMethod(CoolParser::MethodContext *ctx)
+void TypeChecker::checkMethod(CoolParser::MethodContext *ctx)
 {
     string methodName = ctx->OBJECTID()->getText();
-    string declaredReturnType = ctx->TYPEID()->getText();
+    int declaredReturnType = typeOf(ctx->TYPEID()->getText());
 
     pushScope();
     for (auto *f : ctx->formal())
     {
-        string tt = f->TYPEID()->getText();
-        if (tt == "SELF_TYPE")
+        int tt = typeOf(f->TYPEID()->getText());
+        if (tt == SELF_TYPE_INDEX)
         {
             popScope();
-            return any{string{"__ERROR"}};
+            return;
         }
-        scopes.back()[f->OBJECTID()->getText()] = f->TYPEID()->getText();
+        scopes.back()[f->OBJECTID()->getText()] = tt;
     }
 
     current_method = methodName;
 
-    any bodyAny = visit(ctx->expr());
-
-    string bodyType = "__ERROR";
-
-    if (bodyAny.has_value() && bodyAny.type() == typeid(string))
-        bodyType = any_cast<string>(bodyAny);
-
-    unordered_set<string> possibleSelfTypes;
-    unordered_set<string> visitedP;
+    int bodyType = checkExpr(ctx->expr());
 
-    possibleSelfTypes.insert(current_class);
-    possibleSelfTypes.insert("Object");
-    possibleSelfTypes.insert("SELF_TYPE");
+    if (bodyType == NO_TYPE_INDEX)
+        bodyType = ERROR_TYPE_INDEX;
 
-    string current = parent.at(current_class);
-    while (classes.count(current))
-    {
-        if (visitedP.count(current))
-        {
-            break;
-        }
-        visitedP.insert(current);
-
-        possibleSelfTypes.insert(current);
-        current = parent.at(current);
-    }
     // maybe use everywhere
     bool isBuiltin =
-        declaredReturnType == "Int" ||
-        declaredReturnType == "Bool" ||
-        declaredReturnType == "String" ||
-        declaredReturnType == "Object" ||
-        declaredReturnType == "SELF_TYPE";
+        declaredReturnType == INT_INDEX ||
+        declaredReturnType == BOOL_INDEX ||
+        declaredReturnType == STRING_INDEX ||
+        declaredReturnType == OBJECT_INDEX ||
+        declaredReturnType == SELF_TYPE_INDEX;
 
-    if (!isBuiltin && !classes.count(declaredReturnType))
+    if (!isBuiltin && !isClass(declaredReturnType))
     {
-        errors.push_back("Method `" + methodName + "` in class `" + current_class + "` declared to have return type `" + declaredReturnType + "` which is undefined");
+        errors.push_back("Method `" + methodName + "` in class `" + current_class + "` declared to have return type `" + nameOf(declaredReturnType) + "` which is undefined");
     }
-    else if (bodyType == "SELF_TYPE" && !visitedMethods.count(methodName))
+    else if (bodyType == SELF_TYPE_INDEX && !visitedMethods.count(methodName))
     {
-        if (!possibleSelfTypes.count(declaredReturnType))
+        if (!isSelfOrAncestor(declaredReturnType, current_class_index))
         {
             errors.push_back(
                 "In class `" + current_class +
                 "` method `" + methodName +
-                "`: `SELF_TYPE` is not `" + declaredReturnType +
+                "`: `SELF_TYPE` is not `" + nameOf(declaredReturnType) +
                 "`: type of method body is not a subtype of return type");
         }
     }
-    else if (bodyType != "__ERROR" && bodyType != "SELF_TYPE")
+    else if (bodyType != ERROR_TYPE_INDEX && bodyType != SELF_TYPE_INDEX)
     {
-        bool isSubtype = false;
-        string t = bodyType;
-        while (true)
-        {
-            if (t == declaredReturnType)
-            {
-                isSubtype = true;
-                break;
-            }
-            if (!parent.count(t))
-                break;
-            t = parent.at(t);
-        }
-
-        if (!isSubtype)
+        if (!isSubtype(bodyType, declaredReturnType))
         {
             errors.push_back(
                 "In class `" + current_class +
                 "` method `" + methodName +
-                "`: `" + bodyType +
-                "` is not `" + declaredReturnType +
+                "`: `" + nameOf(bodyType) +
+                "` is not `" + nameOf(declaredReturnType) +
                 "`: type of method body is not a subtype of return type");
         }
     }
@@ -176,126 +171,132 @@ std::any TypeChecker::visitMethod(CoolParser::MethodContext *ctx)
     visitedMethods.insert(methodName);
 
     popScope();
-    return nullptr;
 }
 
-std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
+int TypeChecker::checkExpr(CoolParser::ExprContext *ctx)
 {
     if (ctx->STR_CONST())
-        return std::any{std::string{"String"}};
+        return STRING_INDEX;
     if (ctx->INT_CONST())
-        return std::any{std::string{"Int"}};
+        return INT_INDEX;
     if (ctx->BOOL_CONST())
-        return std::any{std::string{"Bool"}};
+        return BOOL_INDEX;
 
     if (ctx->PLUS() || ctx->MINUS() || ctx->STAR() || ctx->SLASH())
     {
-        auto lAny = visit(ctx->expr(0));
-        auto rAny = visit(ctx->expr(1));
+        int l = checkExpr(ctx->expr(0));
+        int r = checkExpr(ctx->expr(1));
 
-        string l = (lAny.has_value() && lAny.type() == typeid(string)) ? any_cast<string>(lAny) : "__ERROR";
-        string r = (rAny.has_value() && rAny.type() == typeid(string)) ? any_cast<string>(rAny) : "__ERROR";
+        if (l == NO_TYPE_INDEX)
+            l = ERROR_TYPE_INDEX;
+        if (r == NO_TYPE_INDEX)
+            r = ERROR_TYPE_INDEX;
 
-        if (l != "Int")
+        if (l != INT_INDEX)
         {
             errors.push_back(
-                "Left-hand-side of arithmetic expression is not of type `Int`, but of type `" + l + "`");
+                "Left-hand-side of arithmetic expression is not of type `Int`, but of type `" + nameOf(l) + "`");
         }
 
-        if (r != "Int")
+        if (r != INT_INDEX)
         {
             errors.push_back(
-                "Right-hand-side of arithmetic expression is not of type `Int`, but of type `" + r + "`");
+                "Right-hand-side of arithmetic expression is not of type `Int`, but of type `" + nameOf(r) + "`");
         }
 
-        return any{string{"Int"}};
+        return INT_INDEX;
     }
 
     if (ctx->LT() || ctx->LE())
     {
-        auto lAny = visit(ctx->expr(0));
-        auto rAny = visit(ctx->expr(1));
+        int l = checkExpr(ctx->expr(0));
+        int r = checkExpr(ctx->expr(1));
 
-        string l = (lAny.has_value() && lAny.type() == typeid(string)) ? any_cast<string>(lAny) : "__ERROR";
-        string r = (rAny.has_value() && rAny.type() == typeid(string)) ? any_cast<string>(rAny) : "__ERROR";
+        if (l == NO_TYPE_INDEX)
+            l = ERROR_TYPE_INDEX;
+        if (r == NO_TYPE_INDEX)
+            r = ERROR_TYPE_INDEX;
 
-        if (l != "Int")
+        if (l != INT_INDEX)
         {
             errors.push_back(
-                "Left-hand-side of integer comparison is not of type `Int`, but of type `" + l + "`");
+                "Left-hand-side of integer comparison is not of type `Int`, but of type `" + nameOf(l) + "`");
         }
 
-        if (r != "Int")
+        if (r != INT_INDEX)
         {
             errors.push_back(
-                "Right-hand-side of integer comparison is not of type `Int`, but of type `" + r + "`");
+                "Right-hand-side of integer comparison is not of type `Int`, but of type `" + nameOf(r) + "`");
         }
 
-        return any{string{"Bool"}};
+        return BOOL_INDEX;
     }
 
     if (ctx->EQ())
     {
-        auto lAny = visit(ctx->expr(0));
-        auto rAny = visit(ctx->expr(1));
+        int l = checkExpr(ctx->expr(0));
+        int r = checkExpr(ctx->expr(1));
 
-        string l = (lAny.has_value() && lAny.type() == typeid(string)) ? any_cast<string>(lAny) : "__ERROR";
-        string r = (rAny.has_value() && rAny.type() == typeid(string)) ? any_cast<string>(rAny) : "__ERROR";
+        if (l == NO_TYPE_INDEX)
+            l = ERROR_TYPE_INDEX;
+        if (r == NO_TYPE_INDEX)
+            r = ERROR_TYPE_INDEX;
 
-        if ((l == "String" || r == "String") && l != r)
+        if ((l == STRING_INDEX || r == STRING_INDEX) && l != r)
         {
-            errors.push_back("A `String` can only be compared to another `String` and not to a `" + (l == "String" ? r : l) + "`");
+            errors.push_back("A `String` can only be compared to another `String` and not to a `" + nameOf(l == STRING_INDEX ? r : l) + "`");
         }
-        else if ((l == "Int" || r == "Int") && l != r)
+        else if ((l == INT_INDEX || r == INT_INDEX) && l != r)
         {
-            errors.push_back("An `Int` can only be compared to another `Int` and not to a `" + (l == "Int" ? r : l) + "`");
+            errors.push_back("An `Int` can only be compared to another `Int` and not to a `" + nameOf(l == INT_INDEX ? r : l) + "`");
         }
-        else if ((l == "Bool" || r == "Bool") && l != r)
+        else if ((l == BOOL_INDEX || r == BOOL_INDEX) && l != r)
         {
-            errors.push_back("A `Bool` can only be compared to another `Bool` and not to a `" + (l == "Bool" ? r : l) + "`");
+            errors.push_back("A `Bool` can only be compared to another `Bool` and not to a `" + nameOf(l == BOOL_INDEX ? r : l) + "`");
         }
 
-        return any{string{"Bool"}};
+        return BOOL_INDEX;
     }
 
     if (ctx->TILDE())
     {
-        auto aa = visit(ctx->expr(0));
-        string expType = (aa.has_value() && aa.type() == typeid(string)) ? any_cast<string>(aa) : "__ERROR";
+        int expType = checkExpr(ctx->expr(0));
+        if (expType == NO_TYPE_INDEX)
+            expType = ERROR_TYPE_INDEX;
 
-        if (expType != "Int")
+        if (expType != INT_INDEX)
         {
             errors.push_back(
-                "Argument of integer negation is not of type `Int`, but of type `" + expType + "`");
+                "Argument of integer negation is not of type `Int`, but of type `" + nameOf(expType) + "`");
         }
 
-        return any{string{"Int"}};
+        return INT_INDEX;
     }
 
     if (ctx->NOT())
     {
-        auto aa = visit(ctx->expr(0));
-        string expType = (aa.has_value() && aa.type() == typeid(string)) ? any_cast<string>(aa) : "__ERROR";
+        int expType = checkExpr(ctx->expr(0));
+        if (expType == NO_TYPE_INDEX)
+            expType = ERROR_TYPE_INDEX;
 
-        if (expType != "Bool")
+        if (expType != BOOL_INDEX)
         {
             errors.push_back(
-                "Argument of boolean negation is not of type `Bool`, but of type `" + expType + "`");
+                "Argument of boolean negation is not of type `Bool`, but of type `" + nameOf(expType) + "`");
         }
 
-        return any{string{"Bool"}};
+        return BOOL_INDEX;
     }
 
     if (ctx->ASSIGN())
     {
         string lhsName = ctx->OBJECTID(0)->getText();
 
-        std::string rhsType = "any";
-        any anyRhsType = visit(ctx->expr(0));
-        if (anyRhsType.has_value() && anyRhsType.type() == typeid(string))
-            rhsType = any_cast<string>(anyRhsType);
+        int rhsType = checkExpr(ctx->expr(0));
+        if (rhsType == NO_TYPE_INDEX)
+            rhsType = ANY_TYPE_INDEX;
 
-        string lhsType;
+        int lhsType;
         if (!lookVarInAllScopes(lhsName, lhsType) && !lookupAttribute(lhsName, lhsType))
         {
             errors.push_back(
@@ -304,40 +305,13 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
             return rhsType;
         }
 
-        unordered_set<string> possibleSelfTypes;
-        unordered_set<string> visitedP;
-
-        possibleSelfTypes.insert(lhsType);
-        possibleSelfTypes.insert("Object");
-        possibleSelfTypes.insert("SELF_TYPE");
-
-        if (parent.count(lhsType))
-        {
-            string current = parent.at(lhsType);
-            while (classes.count(current))
-            {
-                if (visitedP.count(current))
-                {
-                    break;
-                }
-                visitedP.insert(current);
-
-                possibleSelfTypes.insert(current);
-                if (!parent.count(current))
-                {
-                    break;
-                }
-                current = parent.at(current);
-            }
-        }
-
-        if (!possibleSelfTypes.count(rhsType))
+        if (!isSelfOrAncestor(rhsType, lhsType))
         {
             errors.push_back(
                 "In class `" + current_class +
                 "` assignee `" + lhsName +
-                "`: `" + rhsType +
-                "` is not `" + lhsType +
+                "`: `" + nameOf(rhsType) +
+                "` is not `" + nameOf(lhsType) +
                 "`: type of initialization expression is not a subtype of object type");
         }
 
@@ -346,91 +320,47 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
 
     if (ctx->IF())
     {
-        auto condAny = visit(ctx->expr(0));
-        if (!condAny.has_value() || condAny.type() != typeid(string))
-            return std::any{std::string{"__ERROR"}};
+        int condType = checkExpr(ctx->expr(0));
+        if (condType == NO_TYPE_INDEX)
+            return ERROR_TYPE_INDEX;
 
-        string condType = any_cast<string>(condAny);
-        if (condType != "Bool")
+        if (condType != BOOL_INDEX)
         {
             errors.push_back(
-                "Type `" + condType +
+                "Type `" + nameOf(condType) +
                 "` of if-then-else-fi condition is not `Bool`");
         }
 
-        auto thenAny = visit(ctx->expr(1));
-        auto elseAny = visit(ctx->expr(2));
-
-        if (!thenAny.has_value() || !elseAny.has_value())
-            return std::any{std::string{"__ERROR"}};
-
-        string t1 = any_cast<string>(thenAny);
-        string t2 = any_cast<string>(elseAny);
-
-        if (t1 == t2)
-            return std::any{t1};
+        int t1 = checkExpr(ctx->expr(1));
+        int t2 = checkExpr(ctx->expr(2));
 
-        // find he common type
-        unordered_set<string> ancestors;
-        string t = t1;
-        while (true)
-        {
-            ancestors.insert(t);
-            if (!parent.count(t))
-                break;
-            t = parent.at(t);
-        }
-
-        t = t2;
-        string lub = "Object";
-        while (true)
-        {
-            if (ancestors.count(t))
-            {
-                lub = t;
-                break;
-            }
-            if (!parent.count(t))
-                break;
-            t = parent.at(t);
-        }
+        if (t1 == NO_TYPE_INDEX || t2 == NO_TYPE_INDEX)
+            return ERROR_TYPE_INDEX;
 
-        return any{lub};
+        return leastUpperBound(t1, t2, OBJECT_INDEX);
     }
 
     if (ctx->ISVOID())
     {
-        visit(ctx->expr(0));
-        return std::any{std::string{"Bool"}};
+        checkExpr(ctx->expr(0));
+        return BOOL_INDEX;
     }
 
     if (ctx->WHILE())
     {
-        auto a = visit(ctx->expr(0));
-        auto cond = a.has_value() && a.type() == typeid(string) ? any_cast<string>(a) : "__ERROR";
+        int cond = checkExpr(ctx->expr(0));
+        if (cond == NO_TYPE_INDEX)
+            cond = ERROR_TYPE_INDEX;
 
-        bool isSubtype = false;
-        auto t = cond;
-        while (true)
-        {
-            if (t == "Bool")
-            {
-                isSubtype = true;
-                break;
-            }
-            if (!parent.count(t))
-                break;
-            t = parent.at(t);
-        }
-        if (!isSubtype)
+        if (!isSubtype(cond, BOOL_INDEX))
         {
             errors.push_back(
-                "Type `" + cond +
+                "Type `" + nameOf(cond) +
                 "` of while-loop-pool condition is not `Bool`");
         }
 
-        visit(ctx->expr(1));
-        return any{string{"Object"}};
+        checkExpr(ctx->expr(1));
+        return OBJECT_INDEX;
     }
 
     if (ctx->LET())
@@ -440,39 +370,22 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
         {
 
             string name = v->OBJECTID()->getText();
-            string type = v->TYPEID()->getText();
+            int type = typeOf(v->TYPEID()->getText());
             if (v->expr())
             {
-                auto exprTypeAny = (visit(v->expr()));
-                string exprType = "__ERROR";
-                if (exprTypeAny.has_value() && exprTypeAny.type() == typeid(std::string))
-                {
-                    exprType = any_cast<string>(exprTypeAny);
-                }
-
-                bool isSubtype = false;
-                auto t = exprType;
-                while (true)
-                {
-                    if (t == type)
-                    {
-                        isSubtype = true;
-                        break;
-                    }
-                    if (!parent.count(t))
-                        break;
-                    t = parent.at(t);
-                }
+                int exprType = checkExpr(v->expr());
+                if (exprType == NO_TYPE_INDEX)
+                    exprType = ERROR_TYPE_INDEX;
 
-                if (!isSubtype && type != "__ERROR" && exprType != "__ERROR")
+                if (!isSubtype(exprType, type) && type != ERROR_TYPE_INDEX && exprType != ERROR_TYPE_INDEX)
                 {
-                    errors.push_back("Initializer for variable `" + name + "` in let-in expression is of type `" + exprType + "` which is not a subtype of the declared type `" + type + "`");
+                    errors.push_back("Initializer for variable `" + name + "` in let-in expression is of type `" + nameOf(exprType) + "` which is not a subtype of the declared type `" + nameOf(type) + "`");
                 }
             }
 
             scopes.back()[name] = type;
         }
-        auto r = visit(ctx->expr().back());
+        int r = checkExpr(ctx->expr().back());
         popScope();
 
         return r;
@@ -481,27 +394,27 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
     // case
     if (ctx->CASE())
     {
-        unordered_set<string> branchTypes;
-        unordered_set<string> declaredBranchTypes;
+        vector<int> branchTypes;
+        unordered_set<int> declaredBranchTypes;
 
-        visit(ctx->expr(0));
+        checkExpr(ctx->expr(0));
 
         for (size_t i = 0; i < ctx->OBJECTID().size(); ++i)
         {
             string varName = ctx->OBJECTID(i)->getText();
-            string varType = ctx->TYPEID(i)->getText();
+            int varType = typeOf(ctx->TYPEID(i)->getText());
             pushScope();
-            if (varType == "SELF_TYPE")
+            if (varType == SELF_TYPE_INDEX)
             {
                 errors.push_back(
                     "`" + varName + "` in case-of-esac declared to be of type `SELF_TYPE` which is not allowed");
             }
-            else if (!classes.count(varType) &&
-                     varType != "Int" && varType != "Bool" &&
-                     varType != "String" && varType != "Object")
+            else if (!isClass(varType) &&
+                     varType != INT_INDEX && varType != BOOL_INDEX &&
+                     varType != STRING_INDEX && varType != OBJECT_INDEX)
             {
                 errors.push_back(
-                    "Option `" + varName + "` in case-of-esac declared to have unknown type `" + varType + "`");
+                    "Option `" + varName + "` in case-of-esac declared to have unknown type `" + nameOf(varType) + "`");
             }
             else
             {
@@ -511,72 +424,49 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
 
             if (declaredBranchTypes.count(varType))
             {
-                errors.push_back("Multiple options match on type `" + varType + "`");
+                errors.push_back("Multiple options match on type `" + nameOf(varType) + "`");
             }
             declaredBranchTypes.insert(varType);
 
-            auto bodyAny = visit(ctx->expr(i + 1));
-            if (bodyAny.has_value() && bodyAny.type() == typeid(string))
+            int a = checkExpr(ctx->expr(i + 1));
+            if (a != NO_TYPE_INDEX)
             {
-                auto a = any_cast<string>(bodyAny);
-                branchTypes.insert(a);
+                branchTypes.push_back(a);
             }
 
             popScope();
         }
 
         if (branchTypes.empty())
-            return any{string{"__ERROR"}};
+            return ERROR_TYPE_INDEX;
 
-        string lub = *branchTypes.begin();
-        for (auto &cur : branchTypes)
+        // Joining the branches in any order gives the same type.
+        int lub = branchTypes.front();
+        for (int cur : branchTypes)
         {
-            unordered_set<string> ancestors;
-
-            string t = lub;
-            while (true)
-            {
-                ancestors.insert(t);
-                if (!parent.count(t))
-                    break;
-                t = parent.at(t);
-            }
-
-            t = cur;
-            lub = "__ERROR";
-            while (true)
-            {
-                if (ancestors.count(t))
-                {
-                    lub = t;
-                    break;
-                }
-                if (!parent.count(t))
-                    break;
-                t = parent.at(t);
-            }
+            lub = leastUpperBound(lub, cur, ERROR_TYPE_INDEX);
         }
-        return any{lub};
+        return lub;
     }
 
     if (ctx->NEW())
     {
-        string typeName = ctx->TYPEID(0)->getText();
+        int typeName = typeOf(ctx->TYPEID(0)->getText());
 
         bool isBuiltin =
-            typeName == "Int" ||
-            typeName == "Bool" ||
-            typeName == "String" ||
-            typeName == "Object" || typeName == "SELF_TYPE";
+            typeName == INT_INDEX ||
+            typeName == BOOL_INDEX ||
+            typeName == STRING_INDEX ||
+            typeName == OBJECT_INDEX || typeName == SELF_TYPE_INDEX;
 
-        if (!classes.count(typeName) && !isBuiltin)
+        if (!isClass(typeName) && !isBuiltin)
         {
             errors.push_back(
-                "Attempting to instantiate unknown class `" + typeName + "`");
-            return any{string{"__ERROR"}};
+                "Attempting to instantiate unknown class `" + nameOf(typeName) + "`");
+            return ERROR_TYPE_INDEX;
         }
 
-        return any{typeName};
+        return typeName;
     }
 
     // implicit dispatch
@@ -587,79 +477,50 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
     {
 
         std::string methodName = ctx->OBJECTID(0)->getText();
-        std::vector<std::string> argTypes;
+        std::vector<int> argTypes;
         argTypes.reserve(ctx->expr().size());
         for (size_t i = 0; i < ctx->expr().size(); ++i)
         {
-            auto a = visit(ctx->expr(i));
-            if (a.has_value() && a.type() == typeid(std::string))
-            {
-                argTypes.push_back(std::any_cast<std::string>(a));
-            }
-            else
-                argTypes.push_back("__ERROR");
+            int a = checkExpr(ctx->expr(i));
+            argTypes.push_back(a == NO_TYPE_INDEX ? ERROR_TYPE_INDEX : a);
         }
 
-        std::string cls = current_class;
-
-        while (true)
+        if (auto *method = findMethod(current_class_index, methodName))
         {
-            if (methodReturnTypes.count(cls) && methodReturnTypes[cls].count(methodName))
+            const std::string &cls = nameOf(method->defined_in);
+            auto &params = method->parameter_types;
+
+            if (params.size() != argTypes.size())
+            {
+                errors.push_back(
+                    "Method `" + methodName + "` of type `" + cls +
+                    "` called with the wrong number of arguments; " +
+                    std::to_string(params.size()) +
+                    " arguments expected, but " +
+                    std::to_string(argTypes.size()) + " provided");
+                return ERROR_TYPE_INDEX;
+            }
+
+            for (size_t i = 0; i < params.size(); ++i)
             {
-                auto &params = methodParamTypes[cls][methodName];
+                int actual = argTypes[i];
+                int expected = params[i];
 
-                if (params.size() != argTypes.size())
-                {
-                    errors.push_back(
-                        "Method `" + methodName + "` of type `" + cls +
-                        "` called with the wrong number of arguments; " +
-                        std::to_string(params.size()) +
-                        " arguments expected, but " +
-                        std::to_string(argTypes.size()) + " provided");
-                    return std::any{std::string{"__ERROR"}};
-                }
+                int t = (actual == SELF_TYPE_INDEX) ? current_class_index : actual;
 
-                for (size_t i = 0; i < params.size(); ++i)
+                if (!isSubtype(t, expected))
                 {
-                    std::string actual = argTypes[i];
-                    std::string expected = params[i];
-
-                    std::string t = (actual == "SELF_TYPE") ? current_class : actual;
-
-                    bool isSubtype = false;
-                    while (true)
-                    {
-                        if (t == expected)
-                        {
-                            isSubtype = true;
-                            break;
-                        }
-                        if (!parent.count(t))
-                            break;
-                        t = parent.at(t);
-                    }
-
-                    if (!isSubtype)
-                    {
-                        errors.push_back(
-                            "Invalid call to method `" + methodName +
-                            "` from class `" + current_class + "`:");
-                        errors.push_back(
-                            "  `" + actual + "` is not a subtype of `" + expected +
-                            "`: argument at position " + std::to_string(i) +
-                            " (0-indexed) has the wrong type");
-                    }
+                    errors.push_back(
+                        "Invalid call to method `" + methodName +
+                        "` from class `" + current_class + "`:");
+                    errors.push_back(
+                        "  `" + nameOf(actual) + "` is not a subtype of `" + nameOf(expected) +
+                        "`: argument at position " + std::to_string(i) +
+                        " (0-indexed) has the wrong type");
                 }
-
-                std::string ret = methodReturnTypes[cls][methodName];
-                return (ret == "SELF_TYPE")
-                           ? std::any{std::string{"SELF_TYPE"}}
-                           : std::any{ret};
             }
 
-            if (!parent.count(cls))
-                break;
-            cls = parent.at(cls);
+            return method->return_type;
         }
     }
 
@@ -668,259 +529,179 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
         ctx->OBJECTID().size() == 1 &&
         ctx->TYPEID().empty() && ctx->DOT() != nullptr)
     {
-        auto anyRhsType = visit(ctx->expr(0));
-        if (!anyRhsType.has_value() || anyRhsType.type() != typeid(string))
-            return std::any{std::string{"__ERROR"}};
+        int rhsType = checkExpr(ctx->expr(0));
+        if (rhsType == NO_TYPE_INDEX)
+            return ERROR_TYPE_INDEX;
 
-        std::string rhsType = any_cast<string>(anyRhsType);
         std::string methodName = ctx->OBJECTID(0)->getText();
 
-        std::string cls =
-            rhsType == "SELF_TYPE" ? current_class : rhsType;
+        int cls =
+            rhsType == SELF_TYPE_INDEX ? current_class_index : rhsType;
 
-        vector<string> argTypes;
+        vector<int> argTypes;
         for (size_t i = 1; i < ctx->expr().size(); ++i)
         {
-            auto a = visit(ctx->expr(i));
-            if (a.has_value() && a.type() == typeid(string))
-                argTypes.push_back(any_cast<string>(a));
-            else
-                argTypes.push_back("__ERROR");
+            int a = checkExpr(ctx->expr(i));
+            argTypes.push_back(a == NO_TYPE_INDEX ? ERROR_TYPE_INDEX : a);
         }
 
-        while (cls != "Object")
+        // The methods of Object itself are not found on a dispatch.
+        auto *method = findMethod(cls, methodName);
+        if (cls != OBJECT_INDEX && method && method->defined_in != OBJECT_INDEX)
         {
-            if (methodReturnTypes.count(cls) &&
-                methodReturnTypes[cls].count(methodName))
+            cls = method->defined_in;
+            auto &params = method->parameter_types;
+
+            if (params.size() != argTypes.size())
             {
-                auto &params = methodParamTypes[cls][methodName];
+                errors.push_back(
+                    "Method `" + methodName + "` of type `" + nameOf(cls) +
+                    "` called with the wrong number of arguments; " +
+                    to_string(params.size()) +
+                    " arguments expected, but " +
+                    to_string(argTypes.size()) + " provided");
+                return ERROR_TYPE_INDEX;
+            }
 
-                if (params.size() != argTypes.size())
-                {
-                    errors.push_back(
-                        "Method `" + methodName + "` of type `" + cls +
-                        "` called with the wrong number of arguments; " +
-                        to_string(params.size()) +
-                        " arguments expected, but " +
-                        to_string(argTypes.size()) + " provided");
-                    return std::any{std::string{"__ERROR"}};
-                }
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                int actual = argTypes[i];
+                int expected = params[i];
 
-                for (size_t i = 0; i < params.size(); ++i)
-                {
-                    string actual = argTypes[i];
-                    string expected = params[i];
-
-                    string t = actual == "SELF_TYPE"
-                                   ? current_class
-                                   : actual;
-
-                    bool isSubtype = false;
-                    while (true)
-                    {
-                        if (t == expected)
-                        {
-                            isSubtype = true;
-                            break;
-                        }
-                        if (!parent.count(t))
-                            break;
-                        t = parent.at(t);
-                    }
-
-                    if (!isSubtype)
-                    {
-
-                        string base = (rhsType == "SELF_TYPE") ? current_class : rhsType;
-
-                        errors.push_back(
-                            "Invalid call to method `" + methodName +
-                            "` from class `" + base + "`:");
-                        errors.push_back(
-                            "  `" + actual + "` is not a subtype of `" +
-                            expected +
-                            "`: argument at position " +
-                            to_string(i) +
-                            " (0-indexed) has the wrong type");
-                    }
-                }
+                int t = actual == SELF_TYPE_INDEX
+                            ? current_class_index
+                            : actual;
 
-                std::string returnT = methodReturnTypes[cls][methodName];
-                if (returnT == "SELF_TYPE")
-                {
-                    return std::any{std::string{"SELF_TYPE"}};
-                }
-                else
+                if (!isSubtype(t, expected))
                 {
-                    return std::any{returnT};
+
+                    int base = (rhsType == SELF_TYPE_INDEX) ? current_class_index : rhsType;
+
+                    errors.push_back(
+                        "Invalid call to method `" + methodName +
+                        "` from class `" + nameOf(base) + "`:");
+                    errors.push_back(
+                        "  `" + nameOf(actual) + "` is not a subtype of `" +
+                        nameOf(expected) +
+                        "`: argument at position " +
+                        to_string(i) +
+                        " (0-indexed) has the wrong type");
                 }
             }
 
-            if (!parent.count(cls))
-                break;
-
-            cls = parent.at(cls);
+            return method->return_type;
         }
 
-        string base = (rhsType == "SELF_TYPE") ? current_class : rhsType;
-        if (base != "__ERROR")
+        int base = (rhsType == SELF_TYPE_INDEX) ? current_class_index : rhsType;
+        if (base != ERROR_TYPE_INDEX)
             errors.push_back(
                 "Method `" + methodName +
-                "` not defined for type `" + base +
+                "` not defined for type `" + nameOf(base) +
                 "` in dynamic dispatch");
 
-        return std::any{std::string{"__ERROR"}};
+        return ERROR_TYPE_INDEX;
     }
 
     // static dispatch
     if (ctx->expr().size() >= 1 && ctx->OBJECTID().size() >= 1 && ctx->TYPEID().size() == 1 && ctx->AT() != nullptr)
     {
 
-        auto anyRhsType = visit(ctx->expr(0));
-        if (!anyRhsType.has_value() || anyRhsType.type() != typeid(string))
-            return std::any{std::string{"__ERROR"}};
-        std::string rhsType = any_cast<string>(anyRhsType);
-        std::string actualCls =
-            rhsType == "SELF_TYPE" ? current_class : rhsType;
+        int rhsType = checkExpr(ctx->expr(0));
+        if (rhsType == NO_TYPE_INDEX)
+            return ERROR_TYPE_INDEX;
+        int actualCls =
+            rhsType == SELF_TYPE_INDEX ? current_class_index : rhsType;
 
-        string staticType = ctx->TYPEID(0)->getText();
+        int staticType = typeOf(ctx->TYPEID(0)->getText());
         string methodName = ctx->OBJECTID(0)->getText();
 
-        if (staticType != "Int" && staticType != "Bool" && staticType != "String" && staticType != "Object" && !classes.count(staticType))
+        if (staticType != INT_INDEX && staticType != BOOL_INDEX && staticType != STRING_INDEX && staticType != OBJECT_INDEX && !isClass(staticType))
         {
             errors.push_back(
-                "Undefined type `" + staticType + "` in static method dispatch");
+                "Undefined type `" + nameOf(staticType) + "` in static method dispatch");
 
-            if (!methodReturnTypes[actualCls].count(methodName))
+            auto *own = findMethod(actualCls, methodName);
+            if (!own || own->defined_in != actualCls)
                 errors.push_back(
                     "Method `" + methodName + "` not defined for type `" +
-                    actualCls + "` in static dispatch");
-
-            return std::any{std::string{"__ERROR"}};
-        }
+                    nameOf(actualCls) + "` in static dispatch");
 
-        bool isSubtype = false;
-        std::string t = actualCls;
-        while (true)
-        {
-            if (t == staticType)
-            {
-                isSubtype = true;
-                break;
-            }
-            if (!parent.count(t))
-                break;
-            t = parent.at(t);
+            return ERROR_TYPE_INDEX;
         }
 
-        if (!isSubtype && actualCls != "__ERROR")
+        if (!isSubtype(actualCls, staticType) && actualCls != ERROR_TYPE_INDEX)
         {
             errors.push_back(
-                "`" + actualCls + "` is not a subtype of `" + staticType + "`");
+                "`" + nameOf(actualCls) + "` is not a subtype of `" + nameOf(staticType) + "`");
         }
 
-        string cls = staticType;
-
-        while (cls != "Object")
+        auto *method = findMethod(staticType, methodName);
+        if (staticType != OBJECT_INDEX && method && method->defined_in != OBJECT_INDEX)
         {
+            int cls = method->defined_in;
+            auto &params = method->parameter_types;
 
-            if (methodReturnTypes.count(cls) &&
-                methodReturnTypes[cls].count(methodName))
+            // Arguments without a type are left out.
+            vector<int> argTypes;
+            for (size_t i = 1; i < ctx->expr().size(); ++i)
             {
+                int a = checkExpr(ctx->expr(i));
+                if (a != NO_TYPE_INDEX)
+                    argTypes.push_back(a);
+            }
 
-                auto &params = methodParamTypes[cls][methodName];
-
-                vector<string> argTypes;
-                for (size_t i = 1; i < ctx->expr().size(); ++i)
-                {
-                    auto a = visit(ctx->expr(i));
-                    if (a.has_value() && a.type() == typeid(string))
-                        argTypes.push_back(any_cast<string>(a));
-                }
+            if (params.size() != argTypes.size())
+            {
+                errors.push_back(
+                    "Method `" + methodName + "` of type `" + nameOf(cls) +
+                    "` called with the wrong number of arguments; " +
+                    to_string(params.size()) +
+                    " arguments expected, but " +
+                    to_string(argTypes.size()) + " provided");
+                return ERROR_TYPE_INDEX;
+            }
 
-                if (params.size() != argTypes.size())
-                {
-                    errors.push_back(
-                        "Method `" + methodName + "` of type `" + cls +
-                        "` called with the wrong number of arguments; " +
-                        to_string(params.size()) +
-                        " arguments expected, but " +
-                        to_string(argTypes.size()) + " provided");
-                    return std::any{std::string{"__ERROR"}};
-                }
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                int actualArg = argTypes[i];
+                int expected = params[i];
 
-                for (size_t i = 0; i < params.size(); ++i)
-                {
-                    string actualArg = argTypes[i];
-                    string expected = params[i];
-
-                    string t = actualArg == "SELF_TYPE"
-                                   ? current_class
-                                   : actualArg;
-
-                    bool isSubtype = false;
-                    while (true)
-                    {
-                        if (t == expected)
-                        {
-                            isSubtype = true;
-                            break;
-                        }
-                        if (!parent.count(t))
-                            break;
-                        t = parent.at(t);
-                    }
-
-                    if (!isSubtype)
-                    {
-                        errors.push_back(
-                            "Invalid call to method `" + methodName + "` from class `" + cls + "`:");
-                        errors.push_back("  `" +
-                                         actualArg + "` is not a subtype of `" + expected +
-                                         "`: argument at position " + to_string(i) +
-                                         " (0-indexed) has the wrong type");
-                    }
-                }
+                int t = actualArg == SELF_TYPE_INDEX
+                            ? current_class_index
+                            : actualArg;
 
-                std::string returnT = methodReturnTypes[cls][methodName];
-                if (returnT == "SELF_TYPE")
+                if (!isSubtype(t, expected))
                 {
-                    return std::any{std::string{"SELF_TYPE"}};
-                }
-                else
-                {
-                    return std::any{returnT};
+                    errors.push_back(
+                        "Invalid call to method `" + methodName + "` from class `" + nameOf(cls) + "`:");
+                    errors.push_back("  `" +
+                                     nameOf(actualArg) + "` is not a subtype of `" + nameOf(expected) +
+                                     "`: argument at position " + to_string(i) +
+                                     " (0-indexed) has the wrong type");
                 }
             }
 
-            if (!parent.count(cls))
-            {
-                break;
-            }
-
-            cls = parent.at(cls);
+            return method->return_type;
         }
 
         errors.push_back(
-            "Method `" + methodName + "` not defined for type `" + staticType +
+            "Method `" + methodName + "` not defined for type `" + nameOf(staticType) +
             "` in static dispatch");
-        return std::any{std::string{"__ERROR"}};
+        return ERROR_TYPE_INDEX;
     }
 
     if (ctx->OPAREN())
     {
         if (ctx->expr(0))
         {
-            auto aa = visit(ctx->expr(0));
-            string expType = (aa.has_value() && aa.type() == typeid(string)) ? any_cast<string>(aa) : "__ERROR";
-
-            return expType;
+            int expType = checkExpr(ctx->expr(0));
+            return expType == NO_TYPE_INDEX ? ERROR_TYPE_INDEX : expType;
         }
     }
 
     if (!ctx->OBJECTID().empty() && ctx->OBJECTID(0)->getText() == "self")
     {
-        return std::any{std::string{"SELF_TYPE"}};
+        return SELF_TYPE_INDEX;
     }
 
     if (!ctx->OBJECTID().empty())
@@ -928,113 +709,113 @@ std::any TypeChecker::visitExpr(CoolParser::ExprContext *ctx)
         std::string name = ctx->OBJECTID(0)->getText();
 
         if (name == "self")
-            return std::any{std::string{"SELF_TYPE"}};
+            return SELF_TYPE_INDEX;
 
-        string t;
+        int t;
         if (lookVarInAllScopes(name, t))
-            return any{t};
+            return t;
 
         if (lookupAttribute(name, t))
         {
-            return any{t};
+            return t;
         }
 
         errors.push_back(
             "Variable named `" + name + "` not in scope");
 
-        return std::any{std::string{"__ERROR"}};
+        return ERROR_TYPE_INDEX;
     }
 
-    return visitChildren(ctx);
+    // A block, whose value has no type here.
+    for (auto *e : ctx->expr())
+    {
+        checkExpr(e);
+    }
+    return NO_TYPE_INDEX;
 }
 
-std::any TypeChecker::visitAttr(CoolParser::AttrContext *ctx)
+void TypeChecker::checkAttr(CoolParser::AttrContext *ctx)
 {
     std::string attrName = ctx->OBJECTID()->getText();
 
     if (!attrTypes.count(attrName))
     {
-        return nullptr;
+        return;
     }
 
-    std::string declaredType = attrTypes[attrName];
+    int declaredType = attrTypes[attrName];
 
     if (ctx->expr())
     {
-        auto initTypeAny = visit(ctx->expr());
-        if (initTypeAny.has_value())
+        int initType = checkExpr(ctx->expr());
+        if (initType != NO_TYPE_INDEX)
         {
-            std::string initType = std::any_cast<std::string>(initTypeAny);
-
-            unordered_set<string> possibleSelfTypes;
-            unordered_set<string> visitedP;
-
-            possibleSelfTypes.insert(initType);
-            possibleSelfTypes.insert("Object");
-            possibleSelfTypes.insert("SELF_TYPE");
-
-            if (parent.count(initType))
-            {
-                string current = parent.at(initType);
-                while (classes.count(current))
-                {
-                    if (visitedP.count(current))
-                    {
-                        break;
-                    }
-                    visitedP.insert(current);
-
-                    possibleSelfTypes.insert(current);
-                    if (!parent.count(current))
-                    {
-                        break;
-                    }
-                    current = parent.at(current);
-                }
-            }
-
-            if (!possibleSelfTypes.count(declaredType) && initType != "SELF_TYPE" && initType != "__ERROR")
+            if (!isSelfOrAncestor(declaredType, initType) && initType != SELF_TYPE_INDEX && initType != ERROR_TYPE_INDEX)
             {
                 errors.push_back(
                     "In class `" + current_class + "` attribute `" + attrName +
-                    "`: `" + initType + "` is not `" + declaredType +
+                    "`: `" + nameOf(initType) + "` is not `" + nameOf(declaredType) +
                     "`: type of initialization expression is not a subtype of declared type");
             }
         }
     }
-
-    return nullptr;
 }
 
 void TypeChecker::pushScope() { scopes.push_back({}); }
 void TypeChecker::popScope() { scopes.pop_back(); }
 
-bool TypeChecker::lookVarInAllScopes(string &name, string &out)
+bool TypeChecker::lookVarInAllScopes(const string &name, int &out)
 {
     for (int i = scopes.size() - 1; i >= 0; --i)
     {
-        if (scopes[i].count(name))
+        auto it = scopes[i].find(name);
+        if (it != scopes[i].end())
         {
-            out = scopes[i][name];
+            out = it->second;
             return true;
         }
     }
     return false;
 }
 
-bool TypeChecker::lookupAttribute(string &name, string &out)
+bool TypeChecker::lookupAttribute(const string &name, int &out)
+{
+    auto type = classTable.find_attribute(current_class_index,
+                                          classTable.get_member_index(name));
+    if (!type)
+        return false;
+
+    out = *type;
+    return true;
+}
+
+bool TypeChecker::isSubtype(int type, int ancestor) const
+{
+    return classTable.is_subclass_of(type, ancestor);
+}
+
+bool TypeChecker::isSelfOrAncestor(int type, int of) const
 {
-    string cls = current_class;
-    while (true)
+    if (type == of || type == OBJECT_INDEX || type == SELF_TYPE_INDEX)
+        return true;
+
+    int current = classTable.get_parent_index(of);
+    for (int steps = 0; isClass(current) && steps < classTable.size(); ++steps)
     {
-        if (attrTypesByClass.count(cls) && attrTypesByClass[cls].count(name))
-        {
-            out = attrTypesByClass[cls][name];
+        if (current == type)
             return true;
-        }
-        if (!parent.count(cls))
-            break;
-        cls = parent.at(cls);
+        current = classTable.get_parent_index(current);
     }
     return false;
-}
\ No newline at end of file
+}
+
+int TypeChecker::leastUpperBound(int a, int b, int none) const
+{
+    int lub = classTable.least_upper_bound(a, b);
+    return lub == NO_TYPE_INDEX ? none : lub;
+}
+
+const ClassTable::MethodInfo *TypeChecker::findMethod(int cls, string_view methodName) const
+{
+    return classTable.find_method(cls, classTable.get_member_index(methodName));
+}
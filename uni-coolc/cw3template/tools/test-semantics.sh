@@ -10,9 +10,12 @@ temp_dir="${project_root}/temp"
 mkdir -p "${temp_dir}"
 
 # first argument: verbose or input
+#   --parallel-check : type check the classes of each test in parallel
+#   --parallel-parse : parse the classes of each test in parallel
 verbose=""
 input=""
 silent=""
+semantics_flags=()
 
 for arg in "$@"; do
     case "$arg" in
@@ -22,6 +25,9 @@ for arg in "$@"; do
         -s)
             silent=true
             ;;
+        --parallel-check|--parallel-parse)
+            semantics_flags+=("$arg")
+            ;;
         *)
             input="$arg"
             ;;
@@ -54,7 +60,7 @@ run_test() {
 
     total_tests=$((total_tests + 1))
 
-    "${bin_dir}/${tool_name}" "${in_path}" > "${sol_path}"
+    "${bin_dir}/${tool_name}" "${semantics_flags[@]}" "${in_path}" > "${sol_path}"
 
     if ! diff_output=$(run_diff "${out_path}" "${sol_path}"); then
         echo "Test ${testname} FAILED"